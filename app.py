@@ -1,5 +1,5 @@
 import os
-from flask import Flask, jsonify, request
+from flask import Flask, jsonify, request, send_from_directory
 from flask_cors import CORS
 import pymssql
 import decimal
@@ -26,6 +26,13 @@ def get_db_connection():
         print(f"Error connecting to database: {e}")
         return None
 
+# --- Front End ---
+
+@app.route('/')
+def index():
+    """Serves index.html from this server, so the page and the API share one origin."""
+    return send_from_directory(os.path.dirname(os.path.abspath(__file__)), 'index.html')
+
 # --- API Routes for Books ---
 
 @app.route('/api/books', methods=['GET'])
@@ -0,0 +1,210 @@
+#pragma once
+
+#if __has_include(<crow.h>)
+#include <crow.h>
+#else
+#include "crow_all.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Crow log handler that takes console output off the request path.
+//
+// log() runs on whichever thread logged and only moves the message into that thread's ring:
+// a fixed-size single-producer, single-consumer queue, so logging threads never contend with
+// each other or with the writer. A background thread drains every ring about every 20 ms. It
+// orders the lines by time, formats them the way crow::CerrLogHandler does, and hands the
+// batch to stderr in one fwrite (stderr is unbuffered, so that is one write() per batch).
+//
+// Info and Debug lines (Crow's Request:/Response: pairs and the handlers' per-request chatter)
+// are sampled down to info_per_second a second; warnings and errors are always queued. A
+// line that finds its ring full is dropped and counted rather than blocking the request.
+// The writer reports both counts once a second while they are non-zero.
+
+class AsyncLogHandler : public crow::ILogHandler {
+public:
+    struct Options {
+        size_t ring_size = 4096;       // Lines buffered per logging thread
+        size_t info_per_second = 1000; // Info/Debug lines kept per second; 0 keeps all
+        std::chrono::milliseconds flush_interval{20};
+    };
+
+    explicit AsyncLogHandler(Options options)
+        : options_(options), writer_([this] { run(); }) {}
+
+    ~AsyncLogHandler() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+    }
+
+    AsyncLogHandler(const AsyncLogHandler&) = delete;
+    AsyncLogHandler& operator=(const AsyncLogHandler&) = delete;
+
+    void log(std::string message, crow::LogLevel level) override {
+        if (level < crow::LogLevel::Warning && options_.info_per_second > 0 && !admit_info()) {
+            sampled_out_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Ring& ring = thread_ring();
+        if (!ring.push({std::move(message), level, std::chrono::system_clock::now()})) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (level >= crow::LogLevel::Error) wake_.notify_one();
+    }
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t sampled_out() const { return sampled_out_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        std::string message;
+        crow::LogLevel level = crow::LogLevel::Info;
+        std::chrono::system_clock::time_point time;
+    };
+
+    class Ring {
+    public:
+        explicit Ring(size_t capacity) : slots_(std::max<size_t>(capacity, 2)) {}
+
+        // Producer side; false when full
+        bool push(Entry&& entry) {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) == slots_.size()) return false;
+            slots_[head % slots_.size()] = std::move(entry);
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side; moves every queued entry into out
+        void drain(std::vector<Entry>& out) {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            const size_t head = head_.load(std::memory_order_acquire);
+            for (; tail != head; ++tail) out.push_back(std::move(slots_[tail % slots_.size()]));
+            tail_.store(tail, std::memory_order_release);
+        }
+
+    private:
+        std::vector<Entry> slots_;
+        alignas(64) std::atomic<size_t> head_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
+    };
+
+    Ring& thread_ring() {
+        struct Cached {
+            const AsyncLogHandler* owner = nullptr;
+            Ring* ring = nullptr;
+        };
+        thread_local Cached cached;
+        if (cached.owner != this) {
+            auto ring = std::make_unique<Ring>(options_.ring_size);
+            cached = {this, ring.get()};
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(std::move(ring));
+        }
+        return *cached.ring;
+    }
+
+    // At most info_per_second Info/Debug lines in each wall-clock second
+    bool admit_info() {
+        const int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t window = window_.load(std::memory_order_relaxed);
+        if (window != second && window_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+            info_in_window_.store(0, std::memory_order_relaxed);
+        }
+        return info_in_window_.fetch_add(1, std::memory_order_relaxed) < options_.info_per_second;
+    }
+
+    void run() {
+        std::vector<Entry> batch;
+        std::string out;
+        uint64_t reported_sampled = 0;
+        uint64_t reported_dropped = 0;
+        auto next_report = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        for (;;) {
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait_for(lock, options_.flush_interval, [this] { return stopping_; });
+                stopping = stopping_;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex_);
+                for (auto& ring : rings_) ring->drain(batch);
+            }
+            std::stable_sort(batch.begin(), batch.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+            for (const auto& entry : batch) format(out, entry.time, entry.level, entry.message);
+            written_.fetch_add(batch.size(), std::memory_order_relaxed);
+            batch.clear();
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= next_report || stopping) {
+                const uint64_t sampled = sampled_out() - reported_sampled;
+                const uint64_t dropped_now = dropped() - reported_dropped;
+                if (sampled > 0 || dropped_now > 0) {
+                    format(out, std::chrono::system_clock::now(), crow::LogLevel::Warning,
+                           "Log: " + std::to_string(sampled) + " info lines sampled out, " + std::to_string(dropped_now) +
+                               " lines dropped on full buffers");
+                }
+                reported_sampled += sampled;
+                reported_dropped += dropped_now;
+                next_report = now + std::chrono::seconds(1);
+            }
+
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), stderr);
+                std::fflush(stderr);
+                out.clear();
+            }
+            if (stopping) return;
+        }
+    }
+
+    // "(YYYY-MM-DD HH:MM:SS) [LEVEL   ] message", UTC like Crow's default handler
+    static void format(std::string& out, std::chrono::system_clock::time_point time, crow::LogLevel level, const std::string& message) {
+        const std::time_t t = std::chrono::system_clock::to_time_t(time);
+        std::tm tm{};
+#if defined(_MSC_VER) || defined(__MINGW32__)
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        char stamp[32];
+        const size_t n = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        static const char* const prefixes[] = {"DEBUG   ", "INFO    ", "WARNING ", "ERROR   ", "CRITICAL"};
+        const size_t index = std::min<size_t>(static_cast<size_t>(level), 4);
+        out.push_back('(');
+        out.append(stamp, n);
+        out.append(") [").append(prefixes[index]).append("] ").append(message).push_back('\n');
+    }
+
+    Options options_;
+    std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::atomic<int64_t> window_{0};
+    std::atomic<size_t> info_in_window_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> sampled_out_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread writer_;  // Last, so it starts after everything it reads
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#if __has_include(<crow.h>)
+#include <crow.h>
+#else
+#include "crow_all.h"
+#endif
+#include "db_executor.h"
+#include "repository.h"
+#include "request_trace.h"
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Awaitable database calls for coroutine route handlers.
+//
+// run_on() hands a blocking call to the database executor and suspends the calling coroutine;
+// the coroutine resumes on its own executor (the connection's I/O thread) with the result, or
+// with the exception the call threw. A suspended request is its coroutine frame and a queue
+// entry rather than a blocked thread. The request's phase timings travel with the call, the
+// same way answer_from_db() carries them.
+//
+// AsyncStorage puts that behind the repository interfaces:
+//   auto book = co_await db.books().find(book_id);
+//   co_await db.readers().insert(reader);
+// Each call runs with a session of its own; work that needs one session for several
+// statements, such as a transaction, goes through run(), which gets the session.
+
+// Thrown at the co_await when the executor's queue is full
+class DbQueueFullError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+namespace async_detail {
+
+template <class Result>
+struct Outcome {
+    std::exception_ptr error;
+    Result value{};
+};
+
+template <>
+struct Outcome<void> {
+    std::exception_ptr error;
+};
+
+// Everything a call needs on the executor thread and back; shared by the job and the completion
+template <class Handler, class Fn, class Result>
+struct Call {
+    Call(Handler h, Fn f) : handler(std::move(h)), fn(std::move(f)) {}
+
+    Handler handler;
+    Fn fn;
+    Outcome<Result> outcome;
+    PhaseClock::Trace trace;
+    std::chrono::steady_clock::time_point queued;
+
+    void run() {
+        PhaseClock& clock = PhaseClock::current();
+        clock.attach(std::move(trace));
+        clock.add(RequestPhase::db_queue, std::chrono::steady_clock::now() - queued);
+        try {
+            if constexpr (std::is_void_v<Result>) {
+                fn();
+            } else {
+                outcome.value = fn();
+            }
+        } catch (...) {
+            outcome.error = std::current_exception();
+        }
+        trace = clock.detach();
+    }
+
+    // On the handler's executor
+    void complete() {
+        PhaseClock::current().attach(std::move(trace));
+        if constexpr (std::is_void_v<Result>) {
+            std::move(handler)(outcome.error);
+        } else {
+            std::move(handler)(outcome.error, std::move(outcome.value));
+        }
+    }
+};
+
+template <class Result>
+struct Signature {
+    using type = void(std::exception_ptr, Result);
+};
+
+template <>
+struct Signature<void> {
+    using type = void(std::exception_ptr);
+};
+
+}  // namespace async_detail
+
+// Runs fn() on executor and resumes the caller with what it returns; inline when executor is null
+template <class Fn>
+asio::awaitable<std::invoke_result_t<Fn&>> run_on(DbExecutor* executor, Fn fn) {
+    using Result = std::invoke_result_t<Fn&>;
+    static_assert(std::is_void_v<Result> || std::is_default_constructible_v<Result>, "run_on() results must be default-constructible");
+    if (!executor) co_return fn();
+
+    co_return co_await asio::async_initiate<const asio::use_awaitable_t<>&, typename async_detail::Signature<Result>::type>(
+        [executor](auto handler, Fn fn) {
+            using Call = async_detail::Call<std::decay_t<decltype(handler)>, Fn, Result>;
+            auto call = std::make_shared<Call>(std::move(handler), std::move(fn));
+            call->trace = PhaseClock::current().detach();
+            call->queued = std::chrono::steady_clock::now();
+            const bool accepted = executor->submit([call] {
+                call->run();
+                asio::post(asio::get_associated_executor(call->handler), [call] { call->complete(); });
+            });
+            if (!accepted) {
+                call->outcome.error = std::make_exception_ptr(DbQueueFullError("Database queue is full"));
+                asio::post(asio::get_associated_executor(call->handler), [call] { call->complete(); });
+            }
+        },
+        asio::use_awaitable, std::move(fn));
+}
+
+class AsyncBookRepository;
+class AsyncReaderRepository;
+class AsyncRecordRepository;
+
+// Storage and the executor its calls run on (null runs them inline, for in-memory storage)
+class AsyncStorage {
+public:
+    AsyncStorage(Storage& storage, DbExecutor* executor) : storage_(&storage), executor_(executor) {}
+
+    AsyncBookRepository books() const;
+    AsyncReaderRepository readers() const;
+    AsyncRecordRepository records() const;
+
+    // fn(StorageSession&) on one session; what it returns is the result of the co_await
+    template <class Fn>
+    auto run(Fn fn) const {
+        return run_on(executor_, [storage = storage_, fn = std::move(fn)]() mutable { return fn(*storage->session()); });
+    }
+
+private:
+    Storage* storage_;
+    DbExecutor* executor_;
+};
+
+class AsyncBookRepository {
+public:
+    explicit AsyncBookRepository(AsyncStorage db) : db_(db) {}
+
+    asio::awaitable<long long> scan(BookScan scan, RowSink<Book> sink) {
+        return db_.run([scan = std::move(scan), sink = std::move(sink)](StorageSession& s) { return s.books().scan(scan, sink); });
+    }
+    asio::awaitable<long long> count() {
+        return db_.run([](StorageSession& s) { return s.books().count(); });
+    }
+    asio::awaitable<std::optional<Book>> find(std::string book_id) {
+        return db_.run([book_id = std::move(book_id)](StorageSession& s) { return s.books().find(book_id); });
+    }
+    // plan belongs to the caller and must outlive the co_await
+    asio::awaitable<long long> search(BookSearchRequest request, RowSink<Book> sink, std::vector<std::string>& plan) {
+        return db_.run([request = std::move(request), sink = std::move(sink), &plan](StorageSession& s) { return s.books().search(request, sink, plan); });
+    }
+    asio::awaitable<void> insert(Book book) {
+        return db_.run([book = std::move(book)](StorageSession& s) { s.books().insert(book); });
+    }
+    asio::awaitable<bool> update(Book book) {
+        return db_.run([book = std::move(book)](StorageSession& s) { return s.books().update(book); });
+    }
+    asio::awaitable<bool> remove(std::string book_id) {
+        return db_.run([book_id = std::move(book_id)](StorageSession& s) { return s.books().remove(book_id); });
+    }
+
+private:
+    AsyncStorage db_;
+};
+
+class AsyncReaderRepository {
+public:
+    explicit AsyncReaderRepository(AsyncStorage db) : db_(db) {}
+
+    asio::awaitable<long long> scan(RowSink<Reader> sink) {
+        return db_.run([sink = std::move(sink)](StorageSession& s) { return s.readers().scan(sink); });
+    }
+    asio::awaitable<std::optional<Reader>> find(std::string reader_id) {
+        return db_.run([reader_id = std::move(reader_id)](StorageSession& s) { return s.readers().find(reader_id); });
+    }
+    asio::awaitable<void> insert(Reader reader) {
+        return db_.run([reader = std::move(reader)](StorageSession& s) { s.readers().insert(reader); });
+    }
+    asio::awaitable<bool> update(Reader reader) {
+        return db_.run([reader = std::move(reader)](StorageSession& s) { return s.readers().update(reader); });
+    }
+    asio::awaitable<bool> remove(std::string reader_id) {
+        return db_.run([reader_id = std::move(reader_id)](StorageSession& s) { return s.readers().remove(reader_id); });
+    }
+
+private:
+    AsyncStorage db_;
+};
+
+class AsyncRecordRepository {
+public:
+    explicit AsyncRecordRepository(AsyncStorage db) : db_(db) {}
+
+    asio::awaitable<long long> scan(RowSink<Record> sink) {
+        return db_.run([sink = std::move(sink)](StorageSession& s) { return s.records().scan(sink); });
+    }
+    asio::awaitable<std::optional<Record>> find(std::string book_id, std::string reader_id) {
+        return db_.run([book_id = std::move(book_id), reader_id = std::move(reader_id)](StorageSession& s) { return s.records().find(book_id, reader_id); });
+    }
+    asio::awaitable<void> insert(Record record) {
+        return db_.run([record = std::move(record)](StorageSession& s) { s.records().insert(record); });
+    }
+    asio::awaitable<bool> update(Record record) {
+        return db_.run([record = std::move(record)](StorageSession& s) { return s.records().update(record); });
+    }
+    asio::awaitable<bool> remove(std::string book_id, std::string reader_id) {
+        return db_.run([book_id = std::move(book_id), reader_id = std::move(reader_id)](StorageSession& s) { return s.records().remove(book_id, reader_id); });
+    }
+
+private:
+    AsyncStorage db_;
+};
+
+inline AsyncBookRepository AsyncStorage::books() const { return AsyncBookRepository(*this); }
+inline AsyncReaderRepository AsyncStorage::readers() const { return AsyncReaderRepository(*this); }
+inline AsyncRecordRepository AsyncStorage::records() const { return AsyncRecordRepository(*this); }
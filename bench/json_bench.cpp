@@ -0,0 +1,97 @@
+// Compares the two ways GET /api/books can serialize a catalog:
+//   wvalue - one crow::json::wvalue per row, collected into {"data":[...]} and dumped
+//   direct - append_row_json straight into one growing buffer (what the server does)
+//
+// usage: json_bench [rows] [runs]    (defaults: 100000 rows, best of 5 runs)
+
+#if __has_include(<crow.h>)
+#include <crow.h>
+#else
+#include "crow_all.h"
+#endif
+#include "row_json.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<Book> make_books(size_t count) {
+    std::vector<Book> books;
+    books.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Book book;
+        book.book_id = "B" + std::to_string(100000 + i);
+        book.book_name = "数据库系统概论 第" + std::to_string(i % 9 + 1) + "版";
+        book.book_isbn = "978-7-04-" + std::to_string(190000 + i % 10000);
+        book.book_author = i % 3 ? "王珊 \"Wang Shan\"" : "Abraham Silberschatz";
+        book.book_publisher = "高等教育出版社";
+        book.interview_times = static_cast<int>(i % 50);
+        book.book_price = 39.5 + static_cast<double>(i % 100) / 4;
+        books.push_back(std::move(book));
+    }
+    return books;
+}
+
+std::string serialize_wvalue(const std::vector<Book>& books) {
+    std::vector<crow::json::wvalue> rows;
+    rows.reserve(books.size());
+    for (const auto& book : books) {
+        crow::json::wvalue row;
+        row["book_id"] = book.book_id;
+        row["book_name"] = book.book_name;
+        row["book_isbn"] = book.book_isbn;
+        row["book_author"] = book.book_author;
+        row["book_publisher"] = book.book_publisher;
+        row["interview_times"] = book.interview_times;
+        row["book_price"] = book.book_price;
+        rows.push_back(std::move(row));
+    }
+    crow::json::wvalue result;
+    result["data"] = std::move(rows);
+    return result.dump();
+}
+
+std::string serialize_direct(const std::vector<Book>& books) {
+    std::string out;
+    out.reserve(64 * 1024);
+    out.append("{\"data\":[");
+    for (size_t i = 0; i < books.size(); ++i) {
+        if (i) out.push_back(',');
+        append_row_json(out, books[i]);
+    }
+    out.append("]}");
+    return out;
+}
+
+template <class Serialize>
+void run(const char* name, const std::vector<Book>& books, int runs, Serialize serialize) {
+    double best_ms = 0;
+    size_t bytes = 0;
+    for (int run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::string body = serialize(books);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || ms < best_ms) best_ms = ms;
+        bytes = body.size();
+    }
+    std::printf("%-7s %10.2f ms %10.0f rows/s %8.1f MB/s %10zu bytes\n", name, best_ms,
+                static_cast<double>(books.size()) / (best_ms / 1000.0),
+                static_cast<double>(bytes) / (1024.0 * 1024.0) / (best_ms / 1000.0), bytes);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+    const auto books = make_books(rows);
+    std::printf("%zu rows, best of %d runs\n", rows, runs);
+    run("wvalue", books, runs, serialize_wvalue);
+    run("direct", books, runs, serialize_direct);
+    return 0;
+}
@@ -0,0 +1,480 @@
+// HTTP load generator for the library server.
+//
+// Each connection gets its own thread and socket and sends one request at a time. The
+// request is drawn from a weighted mix of the REST routes.
+//
+//   closed loop (--rate 0)  every connection sends its next request as soon as the last
+//                           response arrives; measures peak throughput
+//   open loop   (--rate R)  requests are scheduled at a fixed R per second across all
+//                           connections, and latency is measured from the scheduled time, so
+//                           a stalled server shows up as queueing delay instead of silently
+//                           slowing the generator down
+//
+// Before the run, --seed books are added through POST /api/books/bulk (ids lg-seed-<n>) so
+// that get and search have known targets. Results go to stdout and, with --json, to a file
+// that --baseline can compare against later.
+//
+// usage: load_gen [--host 127.0.0.1] [--port 8080] [--connections 16] [--duration 10]
+//                 [--warmup 2] [--rate 0] [--mix list=30,get=30,search=20,create=10,update=5,delete=5]
+//                 [--seed 1000] [--no-keepalive] [--json out.json]
+//                 [--baseline old.json] [--tolerance 0.10]
+//
+// Mix operations: list (GET /api/books?limit=50), page (keyset page after a random seed id),
+// full (GET /api/books), get, search, create, update, delete (books the same connection
+// created), readers (GET /api/readers), records (GET /api/records), bulk (POST
+// /api/books/bulk with 100 rows).
+
+#if __has_include(<crow.h>)
+#include <crow.h>
+#else
+#include "crow_all.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Op { list, page, full, get, search, create, update, remove, readers, records, bulk };
+
+const std::map<std::string, Op> op_names = {
+    {"list", Op::list},     {"page", Op::page},     {"full", Op::full},       {"get", Op::get},
+    {"search", Op::search}, {"create", Op::create}, {"update", Op::update},   {"delete", Op::remove},
+    {"readers", Op::readers}, {"records", Op::records}, {"bulk", Op::bulk},
+};
+
+const char* const words[] = {"database", "system", "network", "algorithm", "history", "journey",
+                             "python", "compiler", "ocean", "mountain", "garden", "river"};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    size_t connections = 16;
+    double duration = 10.0;
+    double warmup = 2.0;
+    double rate = 0.0;  // Requests per second over all connections; 0 is closed loop
+    std::string mix = "list=30,get=30,search=20,create=10,update=5,delete=5";
+    size_t seed = 1000;
+    bool keep_alive = true;
+    std::string json_path;
+    std::string baseline_path;
+    double tolerance = 0.10;
+};
+
+struct MixEntry {
+    std::string name;
+    Op op;
+    unsigned weight;
+};
+
+std::vector<MixEntry> parse_mix(const std::string& spec) {
+    std::vector<MixEntry> mix;
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        const auto eq = item.find('=');
+        const std::string name = item.substr(0, eq);
+        auto found = op_names.find(name);
+        if (found == op_names.end()) throw std::invalid_argument("Unknown operation in --mix: " + name);
+        const unsigned weight = eq == std::string::npos ? 1 : static_cast<unsigned>(std::stoul(item.substr(eq + 1)));
+        if (weight > 0) mix.push_back({name, found->second, weight});
+    }
+    if (mix.empty()) throw std::invalid_argument("--mix selects no operations");
+    return mix;
+}
+
+// One HTTP/1.1 connection, used by one thread; reconnects when the server closes it
+class HttpConnection {
+public:
+    HttpConnection(const asio::ip::tcp::resolver::results_type& endpoints, bool keep_alive)
+        : endpoints_(endpoints), socket_(io_), keep_alive_(keep_alive) {}
+
+    // Sends the request and reads the whole response; returns its status code. Throws
+    // asio::system_error when the connection fails.
+    int request(const char* method, const std::string& target, const std::string& body = {}) {
+        if (!socket_.is_open()) {
+            asio::connect(socket_, endpoints_);
+            socket_.set_option(asio::ip::tcp::no_delay(true));
+            buffer_.clear();
+        }
+
+        out_.clear();
+        out_ += method;
+        out_ += ' ';
+        out_ += target;
+        out_ += " HTTP/1.1\r\nHost: localhost\r\n";
+        out_ += keep_alive_ ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        if (!body.empty() || std::strcmp(method, "GET") != 0) {
+            out_ += "Content-Type: application/json\r\nContent-Length: ";
+            out_ += std::to_string(body.size());
+            out_ += "\r\n";
+        }
+        out_ += "\r\n";
+        out_ += body;
+        asio::write(socket_, asio::buffer(out_));
+
+        const size_t header_end = asio::read_until(socket_, asio::dynamic_buffer(buffer_), "\r\n\r\n") ;
+        const int status = std::atoi(buffer_.c_str() + buffer_.find(' ') + 1);
+        size_t content_length = 0;
+        bool close = !keep_alive_;
+        size_t line = buffer_.find("\r\n") + 2;
+        while (line < header_end - 2) {
+            const size_t next = buffer_.find("\r\n", line);
+            const std::string header = buffer_.substr(line, next - line);
+            const auto colon = header.find(':');
+            std::string name = header.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            const std::string value = colon == std::string::npos ? "" : header.substr(header.find_first_not_of(' ', colon + 1));
+            if (name == "content-length") content_length = std::stoul(value);
+            if (name == "connection" && (value == "close" || value == "Close")) close = true;
+            line = next + 2;
+        }
+
+        const size_t total = header_end + content_length;
+        if (buffer_.size() < total) asio::read(socket_, asio::dynamic_buffer(buffer_), asio::transfer_exactly(total - buffer_.size()));
+        buffer_.erase(0, total);
+
+        if (close) {
+            asio::error_code ignored;
+            socket_.close(ignored);
+        }
+        return status;
+    }
+
+    void reset() {
+        asio::error_code ignored;
+        socket_.close(ignored);
+    }
+
+private:
+    asio::io_context io_;
+    asio::ip::tcp::resolver::results_type endpoints_;
+    asio::ip::tcp::socket socket_;
+    bool keep_alive_;
+    std::string out_;
+    std::string buffer_;
+};
+
+std::string book_json(const std::string& id, const std::string& name, unsigned n) {
+    return "{\"book_id\":\"" + id + "\",\"book_name\":\"" + name + "\",\"book_isbn\":\"978" + std::to_string(1000000 + n) +
+           "\",\"book_author\":\"Load Generator\",\"book_publisher\":\"Bench Press\",\"interview_times\":" +
+           std::to_string(n % 100) + ",\"book_price\":" + std::to_string(10 + n % 90) + ".5}";
+}
+
+struct OpStats {
+    uint64_t requests = 0;
+    uint64_t errors = 0;  // Transport failures and 5xx
+    std::vector<uint32_t> latency_us;
+};
+
+struct WorkerResult {
+    std::vector<OpStats> ops;
+    std::map<int, uint64_t> statuses;  // 0 counts transport failures
+};
+
+struct Run {
+    Options options;
+    std::vector<MixEntry> mix;
+    asio::ip::tcp::resolver::results_type endpoints;
+    Clock::time_point start;
+    Clock::time_point measure_from;
+    Clock::time_point end;
+    std::atomic<uint64_t> next_slot{0};
+    std::string run_id;
+};
+
+void worker(Run& run, size_t index, WorkerResult& result) {
+    HttpConnection conn(run.endpoints, run.options.keep_alive);
+    std::mt19937_64 rng(index * 7919 + 17);
+    unsigned total_weight = 0;
+    for (const auto& entry : run.mix) total_weight += entry.weight;
+    std::uniform_int_distribution<unsigned> pick(0, total_weight - 1);
+    std::vector<std::string> created;
+    unsigned counter = 0;
+    result.ops.resize(run.mix.size());
+
+    const auto interval = run.options.rate > 0 ? std::chrono::duration<double>(1.0 / run.options.rate) : std::chrono::duration<double>(0);
+    const auto seed_id = [&] { return "lg-seed-" + std::to_string(rng() % std::max<size_t>(run.options.seed, 1)); };
+
+    while (true) {
+        Clock::time_point scheduled;
+        if (run.options.rate > 0) {
+            const uint64_t slot = run.next_slot++;
+            scheduled = run.start + std::chrono::duration_cast<Clock::duration>(interval * static_cast<double>(slot));
+            if (scheduled >= run.end) break;
+            std::this_thread::sleep_until(scheduled);
+        } else {
+            scheduled = Clock::now();
+            if (scheduled >= run.end) break;
+        }
+
+        unsigned roll = pick(rng);
+        size_t which = 0;
+        while (roll >= run.mix[which].weight) roll -= run.mix[which++].weight;
+
+        int status = 0;
+        try {
+            switch (run.mix[which].op) {
+                case Op::list: status = conn.request("GET", "/api/books?limit=50"); break;
+                case Op::page: status = conn.request("GET", "/api/books?limit=50&after=" + seed_id()); break;
+                case Op::full: status = conn.request("GET", "/api/books"); break;
+                case Op::get: status = conn.request("GET", "/api/books/" + seed_id()); break;
+                case Op::search:
+                    status = conn.request("GET", std::string("/api/books/search?keyword=") + words[rng() % std::size(words)]);
+                    break;
+                case Op::readers: status = conn.request("GET", "/api/readers"); break;
+                case Op::records: status = conn.request("GET", "/api/records"); break;
+                case Op::update:
+                    if (!created.empty()) {
+                        const std::string& id = created[rng() % created.size()];
+                        status = conn.request("PUT", "/api/books/" + id, book_json(id, "updated " + std::string(words[counter % 12]), counter));
+                        ++counter;
+                        break;
+                    }
+                    [[fallthrough]];
+                case Op::create: {
+                    const std::string id = "lg-" + run.run_id + "-" + std::to_string(index) + "-" + std::to_string(counter);
+                    status = conn.request("POST", "/api/books", book_json(id, std::string(words[counter % 12]) + " volume", counter));
+                    ++counter;
+                    if (status == 201) created.push_back(id);
+                    break;
+                }
+                case Op::remove:
+                    if (created.empty()) {
+                        status = conn.request("DELETE", "/api/books/lg-missing");
+                    } else {
+                        status = conn.request("DELETE", "/api/books/" + created.back());
+                        created.pop_back();
+                    }
+                    break;
+                case Op::bulk: {
+                    std::string body = "[";
+                    for (int i = 0; i < 100; ++i, ++counter) {
+                        if (i) body += ',';
+                        body += book_json("lg-" + run.run_id + "-" + std::to_string(index) + "-" + std::to_string(counter), "bulk", counter);
+                    }
+                    body += ']';
+                    status = conn.request("POST", "/api/books/bulk", body);
+                    break;
+                }
+            }
+        } catch (const std::exception&) {
+            conn.reset();
+            status = 0;
+        }
+        const auto done = Clock::now();
+        if (scheduled < run.measure_from) continue;
+
+        OpStats& stats = result.ops[which];
+        ++stats.requests;
+        if (status == 0 || status >= 500) ++stats.errors;
+        ++result.statuses[status];
+        stats.latency_us.push_back(static_cast<uint32_t>(
+            std::min<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(done - scheduled).count(), UINT32_MAX)));
+    }
+}
+
+// q-quantile of sorted latencies, in microseconds
+double quantile(const std::vector<uint32_t>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    const size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+crow::json::wvalue summarize(std::vector<uint32_t>& latencies, uint64_t requests, uint64_t errors, double seconds) {
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (uint32_t value : latencies) sum += value;
+    crow::json::wvalue json;
+    json["requests"] = requests;
+    json["errors"] = errors;
+    json["throughput_rps"] = seconds > 0 ? static_cast<double>(requests) / seconds : 0.0;
+    json["latency_us"]["mean"] = latencies.empty() ? 0.0 : sum / static_cast<double>(latencies.size());
+    json["latency_us"]["p50"] = quantile(latencies, 0.50);
+    json["latency_us"]["p90"] = quantile(latencies, 0.90);
+    json["latency_us"]["p99"] = quantile(latencies, 0.99);
+    json["latency_us"]["p999"] = quantile(latencies, 0.999);
+    json["latency_us"]["max"] = latencies.empty() ? 0.0 : static_cast<double>(latencies.back());
+    return json;
+}
+
+void print_line(const std::string& name, const crow::json::rvalue& s) {
+    std::printf("%-10s %10lld %8lld %12.1f %10.0f %10.0f %10.0f %10.0f\n", name.c_str(),
+                static_cast<long long>(s["requests"].i()), static_cast<long long>(s["errors"].i()), s["throughput_rps"].d(),
+                s["latency_us"]["p50"].d(), s["latency_us"]["p99"].d(), s["latency_us"]["p999"].d(), s["latency_us"]["max"].d());
+}
+
+// Compares throughput and p99 of every operation in both results; true when one regressed
+// by more than tolerance
+bool compare(const crow::json::rvalue& current, const crow::json::rvalue& baseline, double tolerance) {
+    bool regressed = false;
+    std::printf("\n%-10s %14s %14s %9s %12s %12s %9s\n", "vs base", "rps base", "rps now", "change", "p99 base", "p99 now", "change");
+    const auto row = [&](const std::string& name, const crow::json::rvalue& now, const crow::json::rvalue& base) {
+        const double rps_base = base["throughput_rps"].d();
+        const double rps_now = now["throughput_rps"].d();
+        const double p99_base = base["latency_us"]["p99"].d();
+        const double p99_now = now["latency_us"]["p99"].d();
+        const double rps_change = rps_base > 0 ? rps_now / rps_base - 1 : 0;
+        const double p99_change = p99_base > 0 ? p99_now / p99_base - 1 : 0;
+        const bool bad = rps_change < -tolerance || p99_change > tolerance;
+        regressed |= bad;
+        std::printf("%-10s %14.1f %14.1f %+8.1f%% %12.0f %12.0f %+8.1f%%%s\n", name.c_str(), rps_base, rps_now, rps_change * 100,
+                    p99_base, p99_now, p99_change * 100, bad ? "  REGRESSION" : "");
+    };
+    row("total", current["total"], baseline["total"]);
+    for (const auto& op : current["operations"]) {
+        if (baseline["operations"].has(op.key())) row(std::string(op.key()), op, baseline["operations"][op.key()]);
+    }
+    return regressed;
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--host") options.host = value();
+        else if (arg == "--port") options.port = value();
+        else if (arg == "--connections") options.connections = std::max<size_t>(1, std::stoul(value()));
+        else if (arg == "--duration") options.duration = std::stod(value());
+        else if (arg == "--warmup") options.warmup = std::stod(value());
+        else if (arg == "--rate") options.rate = std::stod(value());
+        else if (arg == "--mix") options.mix = value();
+        else if (arg == "--seed") options.seed = std::stoul(value());
+        else if (arg == "--no-keepalive") options.keep_alive = false;
+        else if (arg == "--json") options.json_path = value();
+        else if (arg == "--baseline") options.baseline_path = value();
+        else if (arg == "--tolerance") options.tolerance = std::stod(value());
+        else throw std::invalid_argument("Unknown option " + arg);
+    }
+    return options;
+}
+
+// Adds the seed books in bulk requests of 1000; existing ids are reported back, not failed
+void seed_books(Run& run) {
+    HttpConnection conn(run.endpoints, true);
+    for (size_t start = 0; start < run.options.seed; start += 1000) {
+        std::string body = "[";
+        for (size_t i = start; i < std::min(run.options.seed, start + 1000); ++i) {
+            if (i != start) body += ',';
+            const std::string name = std::string(words[i % std::size(words)]) + " " + words[(i / 7) % std::size(words)];
+            body += book_json("lg-seed-" + std::to_string(i), name, static_cast<unsigned>(i));
+        }
+        body += ']';
+        const int status = conn.request("POST", "/api/books/bulk", body);
+        if (status != 200) throw std::runtime_error("Seeding failed with HTTP " + std::to_string(status));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Run run;
+    try {
+        run.options = parse_options(argc, argv);
+        run.mix = parse_mix(run.options.mix);
+        asio::io_context io;
+        run.endpoints = asio::ip::tcp::resolver(io).resolve(run.options.host, run.options.port);
+        run.run_id = std::to_string(std::chrono::system_clock::now().time_since_epoch().count() % 1000000007);
+        if (run.options.seed > 0) seed_books(run);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "load_gen: %s\n", e.what());
+        return 1;
+    }
+
+    const Options& options = run.options;
+    std::printf("%zu connections, %s, %.0fs (+%.0fs warmup), mix %s%s\n", options.connections,
+                options.rate > 0 ? ("open loop at " + std::to_string(static_cast<long long>(options.rate)) + " req/s").c_str() : "closed loop",
+                options.duration, options.warmup, options.mix.c_str(), options.keep_alive ? "" : ", no keep-alive");
+
+    run.start = Clock::now();
+    run.measure_from = run.start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    run.end = run.measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+    std::vector<WorkerResult> results(options.connections);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < options.connections; ++i) threads.emplace_back(worker, std::ref(run), i, std::ref(results[i]));
+    for (auto& thread : threads) thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - run.measure_from).count();
+
+    crow::json::wvalue json;
+    json["config"]["host"] = options.host;
+    json["config"]["port"] = options.port;
+    json["config"]["connections"] = options.connections;
+    json["config"]["duration_s"] = options.duration;
+    json["config"]["warmup_s"] = options.warmup;
+    json["config"]["rate"] = options.rate;
+    json["config"]["mix"] = options.mix;
+    json["config"]["keep_alive"] = options.keep_alive;
+    json["elapsed_s"] = seconds;
+
+    std::vector<uint32_t> all;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    for (size_t op = 0; op < run.mix.size(); ++op) {
+        std::vector<uint32_t> latencies;
+        uint64_t op_requests = 0;
+        uint64_t op_errors = 0;
+        for (auto& result : results) {
+            auto& stats = result.ops[op];
+            op_requests += stats.requests;
+            op_errors += stats.errors;
+            latencies.insert(latencies.end(), stats.latency_us.begin(), stats.latency_us.end());
+        }
+        all.insert(all.end(), latencies.begin(), latencies.end());
+        requests += op_requests;
+        errors += op_errors;
+        json["operations"][run.mix[op].name] = summarize(latencies, op_requests, op_errors, seconds);
+    }
+    json["total"] = summarize(all, requests, errors, seconds);
+
+    std::map<int, uint64_t> statuses;
+    for (const auto& result : results) {
+        for (const auto& [status, count] : result.statuses) statuses[status] += count;
+    }
+    for (const auto& [status, count] : statuses) json["status_codes"][status == 0 ? "failed" : std::to_string(status)] = count;
+
+    const std::string text = json.dump();
+    const auto report = crow::json::load(text);
+    std::printf("\n%-10s %10s %8s %12s %10s %10s %10s %10s\n", "operation", "requests", "errors", "req/s", "p50 us", "p99 us", "p999 us", "max us");
+    for (const auto& entry : run.mix) print_line(entry.name, report["operations"][entry.name]);
+    print_line("total", report["total"]);
+    std::printf("status:");
+    for (const auto& [status, count] : statuses) std::printf(" %s=%llu", status == 0 ? "failed" : std::to_string(status).c_str(), static_cast<unsigned long long>(count));
+    std::printf("\n");
+
+    if (!options.json_path.empty()) {
+        std::ofstream(options.json_path) << text << '\n';
+        std::printf("results written to %s\n", options.json_path.c_str());
+    }
+
+    if (!options.baseline_path.empty()) {
+        std::ifstream in(options.baseline_path);
+        std::stringstream content;
+        content << in.rdbuf();
+        const auto baseline = crow::json::load(content.str());
+        if (!baseline) {
+            std::fprintf(stderr, "load_gen: cannot read baseline %s\n", options.baseline_path.c_str());
+            return 1;
+        }
+        if (compare(report, baseline, options.tolerance)) return 2;
+    }
+    return 0;
+}
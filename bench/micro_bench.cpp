@@ -0,0 +1,254 @@
+// Microbenchmarks for the per-row and per-request helpers on the server's hot paths:
+//   utf8/*     UTF-16 -> UTF-8 as OdbcRow::text does it (reused buffer), and as the
+//              allocating wstring_to_utf8 does it, plus the UTF-8 -> UTF-16 direction
+//   row/*      one book row through crow::json::wvalue versus append_row_json
+//   parse/*    crow::json::load of a POST /api/books body and of a 500-row bulk body,
+//              then reading the fields the handlers read
+//   pool/*     BasicConnectionPool acquire/release at 1..32 threads against a 5-slot pool
+//
+// Text comes in three mixes at realistic field lengths: ascii (ids, ISBNs, English titles),
+// chinese (titles, authors and publishers in CJK) and mixed (the two interleaved). Each case
+// runs for at least min-ms and reports the best of 3 runs.
+//
+// usage: micro_bench [filter] [min-ms]    (filter is a substring of the case name; default all, 200 ms)
+
+#if __has_include(<crow.h>)
+#include <crow.h>
+#else
+#include "crow_all.h"
+#endif
+#include "connection_pool.h"
+#include "row_json.h"
+#include "utf8.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* filter = "";
+double min_ms = 200;
+
+// Runs body(iterations) in growing batches until it takes min_ms, three times; prints the
+// fastest per-operation time. bytes is the input size of one operation (0 for none).
+template <class Body>
+void bench(const std::string& name, size_t bytes, Body body) {
+    if (name.find(filter) == std::string::npos) return;
+    double best_ns = 0;
+    for (int run = 0; run < 3; ++run) {
+        size_t iterations = 1;
+        for (;;) {
+            const auto start = Clock::now();
+            body(iterations);
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (ms >= min_ms) {
+                const double ns = ms * 1e6 / static_cast<double>(iterations);
+                if (run == 0 || ns < best_ns) best_ns = ns;
+                break;
+            }
+            iterations *= ms < min_ms / 10 ? 10 : 2;
+        }
+    }
+    if (bytes > 0) {
+        std::printf("%-34s %12.1f ns/op %12.0f op/s %9.1f MB/s\n", name.c_str(), best_ns, 1e9 / best_ns,
+                    static_cast<double>(bytes) / best_ns * 1e9 / (1024.0 * 1024.0));
+    } else {
+        std::printf("%-34s %12.1f ns/op %12.0f op/s\n", name.c_str(), best_ns, 1e9 / best_ns);
+    }
+}
+
+// Keeps the optimizer from dropping a result
+volatile size_t sink;
+void keep(size_t value) { sink = sink + value; }
+
+struct TextMix {
+    const char* name;
+    const char* words[4];
+};
+
+const TextMix mixes[] = {
+    {"ascii", {"Database System Concepts", "Abraham Silberschatz", "McGraw-Hill Education", "978-0-07-802215-9"}},
+    {"chinese", {"数据库系统概论", "王珊 萨师煊", "高等教育出版社", "计算机网络：自顶向下方法"}},
+    {"mixed", {"C++ Primer 中文版", "Stanley B. Lippman 著", "电子工业出版社 PHEI", "深入理解计算机系统 CSAPP"}},
+};
+
+// At least `length` UTF-16 units of text, cycling through words[first..last]
+std::string field_text(const TextMix& mix, size_t length, size_t first = 0, size_t last = 3) {
+    std::string out;
+    std::u16string wide;
+    for (size_t i = first; wide.size() < length; i = i == last ? first : i + 1) {
+        if (!out.empty()) out.push_back(' ');
+        out += mix.words[i];
+        wide.clear();
+        append_utf16(wide, out);
+    }
+    return out;
+}
+
+Book make_book(const TextMix& mix, size_t i) {
+    Book book;
+    book.book_id = "B" + std::to_string(100000 + i);
+    book.book_name = field_text(mix, 24);
+    book.book_isbn = "978-7-04-" + std::to_string(190000 + i % 10000);
+    book.book_author = field_text(mix, 8, 1, 1);
+    book.book_publisher = field_text(mix, 10, 2, 2);
+    book.interview_times = static_cast<int>(i % 50);
+    book.book_price = 39.5 + static_cast<double>(i % 100) / 4;
+    return book;
+}
+
+void transcoding() {
+    for (const auto& mix : mixes) {
+        for (const size_t length : {8, 32, 128}) {
+            const std::string utf8 = field_text(mix, length);
+            std::u16string wide;
+            append_utf16(wide, utf8);
+            const std::string suffix = std::string(mix.name) + "/" + std::to_string(length);
+
+            bench("utf8/from_utf16/" + suffix, wide.size() * 2, [&](size_t n) {
+                std::string out;
+                for (size_t i = 0; i < n; ++i) {
+                    out.clear();
+                    append_utf8(out, wide);
+                    keep(out.size());
+                }
+            });
+            bench("utf8/from_utf16_alloc/" + suffix, wide.size() * 2, [&](size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    std::string out;
+                    append_utf8(out, wide);
+                    keep(out.size());
+                }
+            });
+            bench("utf8/to_utf16/" + suffix, utf8.size(), [&](size_t n) {
+                std::u16string out;
+                for (size_t i = 0; i < n; ++i) {
+                    out.clear();
+                    append_utf16(out, utf8);
+                    keep(out.size());
+                }
+            });
+        }
+    }
+}
+
+void row_serialization() {
+    for (const auto& mix : mixes) {
+        const Book book = make_book(mix, 7);
+        std::string sample;
+        append_row_json(sample, book);
+        const std::string suffix = mix.name;
+
+        bench("row/wvalue/" + suffix, sample.size(), [&](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                crow::json::wvalue row;
+                row["book_id"] = book.book_id;
+                row["book_name"] = book.book_name;
+                row["book_isbn"] = book.book_isbn;
+                row["book_author"] = book.book_author;
+                row["book_publisher"] = book.book_publisher;
+                row["interview_times"] = book.interview_times;
+                row["book_price"] = book.book_price;
+                const std::string out = row.dump();
+                keep(out.size());
+            }
+        });
+        bench("row/append_row_json/" + suffix, sample.size(), [&](size_t n) {
+            std::string out;
+            for (size_t i = 0; i < n; ++i) {
+                out.clear();
+                append_row_json(out, book);
+                keep(out.size());
+            }
+        });
+    }
+}
+
+// The fields POST /api/books reads out of a parsed body
+void read_book(const crow::json::rvalue& json, Book& book) {
+    book.book_id = json["book_id"].s();
+    book.book_name = json["book_name"].s();
+    book.book_isbn = json["book_isbn"].s();
+    book.book_author = json["book_author"].s();
+    book.book_publisher = json["book_publisher"].s();
+    book.interview_times = static_cast<int>(json["interview_times"].i());
+    book.book_price = json["book_price"].d();
+}
+
+void body_parsing() {
+    for (const auto& mix : mixes) {
+        std::string single;
+        append_row_json(single, make_book(mix, 7));
+        std::string bulk = "[";
+        for (size_t i = 0; i < 500; ++i) {
+            if (i) bulk.push_back(',');
+            append_row_json(bulk, make_book(mix, i));
+        }
+        bulk.push_back(']');
+        const std::string suffix = mix.name;
+
+        bench("parse/book/" + suffix, single.size(), [&](size_t n) {
+            Book book;
+            for (size_t i = 0; i < n; ++i) {
+                const auto json = crow::json::load(single);
+                read_book(json, book);
+                keep(book.book_id.size());
+            }
+        });
+        bench("parse/bulk500/" + suffix, bulk.size(), [&](size_t n) {
+            std::vector<Book> books(500);
+            for (size_t i = 0; i < n; ++i) {
+                const auto json = crow::json::load(bulk);
+                size_t row = 0;
+                for (const auto& item : json) read_book(item, books[row++]);
+                keep(books.back().book_id.size());
+            }
+        });
+    }
+}
+
+struct FakeConnection {
+    int uses = 0;
+};
+
+// Threads share one pool and repeatedly check a connection out, touch it and hand it back;
+// reports time per checkout across all threads
+void pool_contention() {
+    for (const size_t threads : {1, 2, 4, 8, 16, 32}) {
+        PoolOptions options;
+        options.acquire_timeout = std::chrono::milliseconds(60000);
+        BasicConnectionPool<FakeConnection> pool([] { return std::make_unique<FakeConnection>(); }, nullptr, options);
+        bench("pool/acquire_release/" + std::to_string(threads) + "t", 0, [&](size_t n) {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                const size_t share = n / threads + (t < n % threads ? 1 : 0);
+                workers.emplace_back([&pool, share] {
+                    for (size_t i = 0; i < share; ++i) {
+                        auto lease = pool.acquire();
+                        ++lease->uses;
+                    }
+                });
+            }
+            for (auto& worker : workers) worker.join();
+        });
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) filter = argv[1];
+    if (argc > 2) min_ms = std::max(1.0, std::atof(argv[2]));
+
+    transcoding();
+    row_serialization();
+    body_parsing();
+    pool_contention();
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+# Starts LibraryManager on a scratch store and runs load_gen against it.
+#
+# usage: bench/run_load.sh [memory|sqlite] [load_gen options...]
+#   BUILD_DIR   build directory holding both executables (default: build)
+#
+# e.g. bench/run_load.sh sqlite --connections 32 --duration 30 --json sqlite.json
+#      bench/run_load.sh memory --rate 5000 --baseline memory.json
+
+set -e
+
+STORAGE=${1:-memory}
+shift || true
+BUILD_DIR=${BUILD_DIR:-build}
+WORK_DIR=$(mktemp -d)
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+case "$STORAGE" in
+    memory) export LIBRARY_STORAGE=memory ;;
+    sqlite) export LIBRARY_STORAGE=sqlite LIBRARY_SQLITE_PATH="$WORK_DIR/library.db" ;;
+    *) echo "storage must be memory or sqlite" >&2; exit 1 ;;
+esac
+
+"$BUILD_DIR/LibraryManager" > "$WORK_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+for _ in $(seq 50); do
+    if (echo > /dev/tcp/127.0.0.1/8080) 2>/dev/null; then break; fi
+    sleep 0.1
+done
+
+"$BUILD_DIR/load_gen" "$@"
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "models.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// In-process inverted index over the book table, used by GET /api/books/search.
+//
+// Text is case-folded (ASCII and full-width forms) and split into terms:
+//   - runs of letters/digits become one lowercase word each
+//   - runs of CJK characters become overlapping bigrams plus single characters,
+//     so Chinese titles match on any two-character window without a dictionary
+//   - the ISBN is also indexed as one normalized digits-only term
+// A query matches a book when every query term occurs in one of the searched fields; the
+// final ASCII word of a query is treated as a prefix so results update while typing.
+// Results are ranked by field weight (title > author > publisher/ISBN) times inverse document frequency.
+// Matching is by word, so answers_substring() says when that agrees with a LIKE '%query%' search.
+
+enum BookField : uint8_t {
+    field_id = 1 << 0,
+    field_name = 1 << 1,
+    field_isbn = 1 << 2,
+    field_author = 1 << 3,
+    field_publisher = 1 << 4,
+    field_all = field_id | field_name | field_isbn | field_author | field_publisher,
+};
+
+namespace book_index_detail {
+
+// Decode one code point starting at s[i]; invalid bytes come back as U+FFFD
+inline char32_t next_code_point(const std::string& s, size_t& i) {
+    const auto byte = [&](size_t k) { return static_cast<unsigned char>(s[k]); };
+    const unsigned char c = byte(i);
+    if (c < 0x80) {
+        ++i;
+        return c;
+    }
+    size_t len = (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+    if (len == 0 || i + len > s.size()) {
+        ++i;
+        return 0xFFFD;
+    }
+    char32_t cp = c & (0x7F >> len);
+    for (size_t k = 1; k < len; ++k) {
+        if ((byte(i + k) & 0xC0) != 0x80) {
+            ++i;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (byte(i + k) & 0x3F);
+    }
+    i += len;
+    return cp;
+}
+
+inline void append_code_point(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+inline bool is_cjk(char32_t cp) {
+    return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) ||
+           (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x20000 && cp <= 0x2FFFF) ||
+           (cp >= 0x3040 && cp <= 0x30FF) || (cp >= 0xAC00 && cp <= 0xD7AF);
+}
+
+// Full-width ASCII to ASCII, then ASCII lowercase
+inline char32_t fold(char32_t cp) {
+    if (cp >= 0xFF01 && cp <= 0xFF5E) cp -= 0xFEE0;
+    if (cp >= 'A' && cp <= 'Z') cp += 'a' - 'A';
+    return cp;
+}
+
+inline bool is_word_char(char32_t cp) {
+    return (cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9') || (cp >= 0xC0 && cp < 0x2000 && cp != 0xD7 && cp != 0xF7);
+}
+
+struct Term {
+    std::string text;
+    bool word = false;  // ASCII/Latin word (eligible for prefix matching) rather than a CJK gram
+};
+
+// Split text into index terms. When for_query is set a CJK run contributes only its bigrams
+// (or the single character if the run has length one), which is what the index must contain.
+inline std::vector<Term> tokenize(const std::string& text, bool for_query) {
+    std::vector<Term> terms;
+    std::string word;
+    std::vector<char32_t> cjk_run;
+
+    const auto flush_word = [&] {
+        if (!word.empty()) terms.push_back({std::move(word), true});
+        word.clear();
+    };
+    const auto flush_cjk = [&] {
+        if (cjk_run.empty()) return;
+        if (!for_query || cjk_run.size() == 1) {
+            for (char32_t cp : cjk_run) {
+                std::string gram;
+                append_code_point(gram, cp);
+                terms.push_back({std::move(gram), false});
+            }
+        }
+        for (size_t k = 0; k + 1 < cjk_run.size(); ++k) {
+            std::string gram;
+            append_code_point(gram, cjk_run[k]);
+            append_code_point(gram, cjk_run[k + 1]);
+            terms.push_back({std::move(gram), false});
+        }
+        cjk_run.clear();
+    };
+
+    for (size_t i = 0; i < text.size();) {
+        const char32_t cp = fold(next_code_point(text, i));
+        if (is_cjk(cp)) {
+            flush_word();
+            cjk_run.push_back(cp);
+        } else if (is_word_char(cp)) {
+            flush_cjk();
+            append_code_point(word, cp);
+        } else {
+            flush_word();
+            flush_cjk();
+        }
+    }
+    flush_word();
+    flush_cjk();
+    return terms;
+}
+
+inline std::string isbn_term(const std::string& isbn) {
+    std::string digits;
+    for (char c : isbn) {
+        if ((c >= '0' && c <= '9') || c == 'x' || c == 'X') digits.push_back(c == 'X' ? 'x' : c);
+    }
+    return digits;
+}
+
+}  // namespace book_index_detail
+
+struct BookSearchHit {
+    Book book;
+    double score = 0.0;
+};
+
+class BookIndex {
+public:
+    // Replace the whole index, e.g. with the book table loaded at startup
+    void rebuild(const std::vector<Book>& books) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        docs_.clear();
+        doc_terms_.clear();
+        free_docs_.clear();
+        ids_.clear();
+        terms_.clear();
+        for (const auto& book : books) insert_locked(book);
+        ready_ = true;
+    }
+
+    // Insert or replace one book (POST/PUT)
+    void upsert(const Book& book) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto found = ids_.find(book.book_id);
+        if (found != ids_.end()) remove_locked(found->second);
+        insert_locked(book);
+    }
+
+    // Insert or replace a batch under one lock (bulk insert and catalog import)
+    void upsert_many(const std::vector<Book>& books) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& book : books) {
+            auto found = ids_.find(book.book_id);
+            if (found != ids_.end()) remove_locked(found->second);
+            insert_locked(book);
+        }
+    }
+
+    void remove(const std::string& book_id) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto found = ids_.find(book_id);
+        if (found != ids_.end()) remove_locked(found->second);
+    }
+
+    // Writers hold this from their database write through the index change that follows it, so
+    // the index sees concurrent writes to a book in the order the database applied them
+    std::mutex& write_mutex() { return write_mutex_; }
+
+    // True when search() finds every book a substring match on query would: CJK text, whose grams
+    // cover any substring, or a single word that no indexed word contains past its first character
+    // (so "ello" is not answered here once "hello" is indexed). Other queries belong to the SQL planner.
+    bool answers_substring(const std::string& query) const {
+        using namespace book_index_detail;
+        const auto query_terms = tokenize(query, true);
+        if (query_terms.empty()) return false;
+        if (std::none_of(query_terms.begin(), query_terms.end(), [](const Term& t) { return t.word; })) return true;
+        if (query_terms.size() != 1) return false;
+        for (size_t i = 0; i < query.size();) {
+            if (!is_word_char(fold(next_code_point(query, i)))) return false;
+        }
+        const std::string& word = query_terms.front().text;
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& entry : terms_) {
+            if (entry.first.size() > word.size() && entry.first.find(word, 1) != std::string::npos) return false;
+        }
+        return true;
+    }
+
+    bool ready() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return ready_;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return ids_.size();
+    }
+
+    // fields restricts which columns must contain each query term (see BookField)
+    std::vector<BookSearchHit> search(const std::string& query, uint8_t fields,
+                                      std::optional<double> min_price, std::optional<double> max_price,
+                                      size_t limit = 0) const {
+        using namespace book_index_detail;
+        auto query_terms = tokenize(query, true);
+        const std::string isbn = isbn_term(query);
+        // Only a blank query (or a bare '*') lists every book; one made of punctuation matches
+        // nothing, as its LIKE '%...%' does on the SQL path
+        if (query_terms.empty() && query.find_first_not_of(" \t*") != std::string::npos) return {};
+
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const double doc_count = static_cast<double>(ids_.size());
+
+        // One candidate map per query term; the last word also absorbs every term it prefixes
+        std::vector<std::unordered_map<uint32_t, double>> per_term;
+        for (size_t t = 0; t < query_terms.size(); ++t) {
+            const bool prefix = query_terms[t].word && t + 1 == query_terms.size();
+            std::unordered_map<uint32_t, double> matches;
+            collect(query_terms[t].text, prefix, fields, doc_count, matches);
+            if (matches.empty() && (fields & field_isbn) && (isbn.size() == 10 || isbn.size() == 13) && query_terms.size() > 1) {
+                // "978-7-..." tokenizes into several numbers; fall back to the joined ISBN term
+                query_terms.clear();
+                per_term.clear();
+                collect(isbn, false, fields, doc_count, matches);
+                per_term.push_back(std::move(matches));
+                break;
+            }
+            if (matches.empty()) return {};
+            per_term.push_back(std::move(matches));
+        }
+
+        std::vector<BookSearchHit> hits;
+        const auto price_ok = [&](const Book& book) {
+            return (!min_price || book.book_price >= *min_price) && (!max_price || book.book_price <= *max_price);
+        };
+
+        if (per_term.empty()) {
+            for (const auto& doc : docs_) {
+                if (doc && price_ok(*doc)) hits.push_back({*doc, 0.0});
+            }
+        } else {
+            std::sort(per_term.begin(), per_term.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+            for (const auto& [doc, first_score] : per_term.front()) {
+                double score = first_score;
+                bool all = true;
+                for (size_t t = 1; t < per_term.size() && all; ++t) {
+                    auto found = per_term[t].find(doc);
+                    if (found == per_term[t].end()) {
+                        all = false;
+                    } else {
+                        score += found->second;
+                    }
+                }
+                if (all && price_ok(*docs_[doc])) hits.push_back({*docs_[doc], score});
+            }
+        }
+
+        std::sort(hits.begin(), hits.end(), [](const BookSearchHit& a, const BookSearchHit& b) {
+            if (a.score != b.score) return a.score > b.score;
+            return a.book.book_id < b.book.book_id;
+        });
+        if (limit && hits.size() > limit) hits.resize(limit);
+        return hits;
+    }
+
+private:
+    struct Posting {
+        uint8_t fields = 0;
+        float weight = 0.0f;
+    };
+    using PostingList = std::unordered_map<uint32_t, Posting>;
+
+    static float field_weight(uint8_t field) {
+        switch (field) {
+            case field_name: return 3.0f;
+            case field_author: return 2.0f;
+            case field_id:
+            case field_isbn: return 1.5f;
+            default: return 1.0f;
+        }
+    }
+
+    void add_terms(uint32_t doc, const std::string& text, uint8_t field, std::vector<std::string>& doc_terms) {
+        for (auto& term : book_index_detail::tokenize(text, false)) add_term(doc, term.text, field, doc_terms);
+    }
+
+    void add_term(uint32_t doc, const std::string& term, uint8_t field, std::vector<std::string>& doc_terms) {
+        auto& posting = terms_[term][doc];
+        if (posting.fields == 0) doc_terms.push_back(term);
+        posting.fields |= field;
+        posting.weight += field_weight(field);
+    }
+
+    void insert_locked(const Book& book) {
+        uint32_t doc;
+        if (!free_docs_.empty()) {
+            doc = free_docs_.back();
+            free_docs_.pop_back();
+        } else {
+            doc = static_cast<uint32_t>(docs_.size());
+            docs_.emplace_back();
+            doc_terms_.emplace_back();
+        }
+        docs_[doc] = book;
+        ids_[book.book_id] = doc;
+
+        auto& doc_terms = doc_terms_[doc];
+        doc_terms.clear();
+        add_terms(doc, book.book_id, field_id, doc_terms);
+        add_terms(doc, book.book_name, field_name, doc_terms);
+        add_terms(doc, book.book_author, field_author, doc_terms);
+        add_terms(doc, book.book_publisher, field_publisher, doc_terms);
+        add_terms(doc, book.book_isbn, field_isbn, doc_terms);
+        const std::string isbn = book_index_detail::isbn_term(book.book_isbn);
+        if (!isbn.empty()) add_term(doc, isbn, field_isbn, doc_terms);
+    }
+
+    void remove_locked(uint32_t doc) {
+        for (const auto& term : doc_terms_[doc]) {
+            auto found = terms_.find(term);
+            if (found == terms_.end()) continue;
+            found->second.erase(doc);
+            if (found->second.empty()) terms_.erase(found);
+        }
+        doc_terms_[doc].clear();
+        ids_.erase(docs_[doc]->book_id);
+        docs_[doc].reset();
+        free_docs_.push_back(doc);
+    }
+
+    void collect(const std::string& term, bool prefix, uint8_t fields, double doc_count,
+                 std::unordered_map<uint32_t, double>& matches) const {
+        const auto add = [&](const PostingList& postings) {
+            const double idf = std::log(1.0 + doc_count / static_cast<double>(postings.size()));
+            for (const auto& [doc, posting] : postings) {
+                if (!(posting.fields & fields)) continue;
+                double& score = matches[doc];
+                score = std::max(score, posting.weight * idf);
+            }
+        };
+        if (!prefix) {
+            auto found = terms_.find(term);
+            if (found != terms_.end()) add(found->second);
+            return;
+        }
+        for (auto it = terms_.lower_bound(term); it != terms_.end() && it->first.compare(0, term.size(), term) == 0; ++it) {
+            add(it->second);
+        }
+    }
+
+    mutable std::shared_mutex mutex_;
+    std::mutex write_mutex_;
+    bool ready_ = false;
+    std::vector<std::optional<Book>> docs_;
+    std::vector<std::vector<std::string>> doc_terms_;
+    std::vector<uint32_t> free_docs_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::map<std::string, PostingList> terms_;  // Ordered so prefix queries are a range walk
+};
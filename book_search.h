@@ -0,0 +1,170 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Query planner for GET /api/books/search.
+//
+// The Python backend ran LIKE '%kw%' over four columns for every search, which is a full
+// scan. Here each part of the request is turned into the cheapest predicate that still
+// answers it:
+//   - ISBN-shaped keywords   -> equality on the normalized ISBN (index seek); with search_by=all
+//                               it is ORed with the other columns' predicates
+//   - prefix matches         -> LIKE 'kw%' (index seek), via match=prefix or a trailing '*'
+//   - exact matches          -> equality (index seek), via match=exact
+//   - price bounds           -> a range predicate on book_price (index range scan)
+//   - anything else          -> LIKE '%kw%', the only remaining scan
+// The seeks assume these indexes exist:
+//   CREATE INDEX ix_book_name ON book(book_name);
+//   CREATE INDEX ix_book_author ON book(book_author);
+//   CREATE INDEX ix_book_publisher ON book(book_publisher);
+//   CREATE INDEX ix_book_isbn ON book(book_isbn);
+//   CREATE INDEX ix_book_price ON book(book_price);
+//   CREATE INDEX ix_book_isbn_normalized ON book(REPLACE(REPLACE(UPPER(book_isbn), '-', ''), ' ', ''));
+// SQL Server cannot index an expression; there the normalized seek needs a persisted computed
+// column with that expression and an index on it, which the optimizer matches to the query.
+// SQLite's LIKE ignores case, so there the prefix seeks use a NOCASE copy of the text indexes
+// (ix_book_name_nocase and so on, see SqliteDatabase::migrate).
+
+struct BookSearchRequest {
+    std::string keyword;
+    std::string search_by = "all";   // all, title, author, publisher, isbn
+    std::string match = "contains";  // contains, prefix, exact
+    std::optional<double> min_price;
+    std::optional<double> max_price;
+};
+
+struct BookSearchPlan {
+    using Param = std::variant<std::string, double>;
+
+    std::string sql;                   // Parameterized with '?' markers
+    std::vector<Param> params;         // In marker order; strings are UTF-8
+    std::vector<std::string> steps;    // Access path per predicate, for the "plan" field of the response
+};
+
+// Strip the separators people type into ISBNs; returns an empty string unless what is left
+// is a plausible ISBN-10 or ISBN-13
+inline std::string normalize_isbn(const std::string& keyword) {
+    std::string digits;
+    for (char c : keyword) {
+        if (c >= '0' && c <= '9') {
+            digits.push_back(c);
+        } else if (c == 'x' || c == 'X') {
+            digits.push_back('X');
+        } else if (c != '-' && c != ' ') {
+            return std::string();
+        }
+    }
+    const auto x = digits.find('X');
+    if (x != std::string::npos && x != digits.size() - 1) return std::string();
+    if (digits.size() == 10 || (digits.size() == 13 && x == std::string::npos)) return digits;
+    return std::string();
+}
+
+// Stored ISBNs keep whatever separators were typed, so ISBN lookups compare this expression
+// (and strip_isbn() in memory) with normalize_isbn() of the keyword
+inline const std::string normalized_isbn_sql = "REPLACE(REPLACE(UPPER(book_isbn), '-', ''), ' ', '')";
+
+// What normalized_isbn_sql computes for a stored ISBN
+inline std::string strip_isbn(const std::string& isbn) {
+    std::string stripped;
+    stripped.reserve(isbn.size());
+    for (char c : isbn) {
+        if (c == '-' || c == ' ') continue;
+        stripped.push_back(c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c);
+    }
+    return stripped;
+}
+
+// Escape LIKE wildcards so user input is matched literally (paired with ESCAPE '\')
+inline std::string escape_like(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '%' || c == '_' || c == '[' || c == '\\') escaped.push_back('\\');
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+inline BookSearchPlan plan_book_search(const BookSearchRequest& request) {
+    BookSearchPlan plan;
+    plan.sql = "SELECT book_id, book_name, book_isbn, book_author, book_publisher, interview_times, book_price FROM book WHERE 1=1";
+
+    std::string keyword = request.keyword;
+    std::string match = request.match;
+    if (!keyword.empty() && keyword.back() == '*') {
+        keyword.pop_back();
+        match = "prefix";
+    }
+
+    if (!keyword.empty()) {
+        const std::string isbn = (request.search_by == "isbn" || request.search_by == "all") ? normalize_isbn(keyword) : std::string();
+
+        std::vector<std::string> columns;
+        if (request.search_by == "title") {
+            columns = {"book_name"};
+        } else if (request.search_by == "author") {
+            columns = {"book_author"};
+        } else if (request.search_by == "publisher") {
+            columns = {"book_publisher"};
+        } else if (request.search_by == "isbn") {
+            if (isbn.empty()) columns = {"book_isbn"};
+        } else {
+            columns = {"book_name", "book_author", "book_publisher"};
+            if (isbn.empty()) columns.push_back("book_isbn");
+        }
+
+        std::string predicate;
+        std::string pattern;
+        std::string step;
+        if (match == "exact") {
+            predicate = " = ?";
+            pattern = keyword;
+            step = "exact_seek";
+        } else if (match == "prefix") {
+            predicate = " LIKE ? ESCAPE '\\'";
+            pattern = escape_like(keyword) + "%";
+            step = "prefix_seek";
+        } else {
+            predicate = " LIKE ? ESCAPE '\\'";
+            pattern = "%" + escape_like(keyword) + "%";
+            step = "substring_scan";
+        }
+
+        plan.sql += " AND (";
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (i) plan.sql += " OR ";
+            plan.sql += columns[i] + predicate;
+            plan.params.emplace_back(pattern);
+            plan.steps.push_back(step + "(" + columns[i] + ")");
+        }
+        if (!isbn.empty()) {
+            if (!columns.empty()) plan.sql += " OR ";
+            plan.sql += normalized_isbn_sql + " = ?";
+            plan.params.emplace_back(isbn);
+            plan.steps.push_back("isbn_exact");
+        }
+        plan.sql += ")";
+    }
+
+    if (request.min_price && request.max_price) {
+        plan.sql += " AND book_price BETWEEN ? AND ?";
+        plan.params.emplace_back(*request.min_price);
+        plan.params.emplace_back(*request.max_price);
+        plan.steps.push_back("price_range");
+    } else if (request.min_price) {
+        plan.sql += " AND book_price >= ?";
+        plan.params.emplace_back(*request.min_price);
+        plan.steps.push_back("price_range");
+    } else if (request.max_price) {
+        plan.sql += " AND book_price <= ?";
+        plan.params.emplace_back(*request.max_price);
+        plan.steps.push_back("price_range");
+    }
+
+    if (plan.steps.empty()) plan.steps.push_back("full_scan");
+    return plan;
+}
@@ -24,14 +24,6 @@ if [ ! -f "$VCPKG_ROOT/scripts/buildsystems/vcpkg.cmake" ]; then
 fi
 echo "vcpkg found."
 
-echo "Checking for Python..."
-if ! command -v python &> /dev/null; then
-    echo "WARNING: Python executable not found in PATH."
-    echo "The frontend server will not be started."
-    echo "Please install Python and add it to your PATH to serve the frontend."
-fi
-echo "Python found."
-
 
 # ============================================================================
 #                         BACKEND COMPILATION
@@ -80,19 +72,13 @@ else
     exit 1
 fi
 
-# Start Frontend Server in the background (if Python is available)
-if command -v python &> /dev/null; then
-    echo "Starting Frontend server on http://localhost:8000"
-    cd "$PROJECT_ROOT"
-    python -m http.server 8000 &
-    FRONTEND_PID=$!
-    echo "Frontend server started with PID $FRONTEND_PID."
-fi
+# The backend serves the front end itself
+echo "Open http://localhost:8080/ in a browser."
 
 echo
-echo "All servers are running in the background."
-echo "You can close this terminal, but the servers will stop."
-echo "To stop the servers, close this terminal or use 'kill $BACKEND_PID $FRONTEND_PID'"
+echo "The server is running in the background."
+echo "You can close this terminal, but the server will stop."
+echo "To stop the server, close this terminal or use 'kill $BACKEND_PID'"
 
 # Keep the script running to show the PIDs, or just exit
 wait
@@ -116,5 +102,5 @@ build/Debug/LibraryManager.exe &
 # 等待后端初始化
 sleep 1
 
-# 启动前端
-start ./index.html
\ No newline at end of file
+# 启动前端（由后端提供）
+start http://localhost:8080/
\ No newline at end of file
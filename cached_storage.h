@@ -0,0 +1,250 @@
+#pragma once
+
+#include "memory_storage.h"
+#include "models.h"
+#include "repository.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A MemoryStorage in front of a slower Storage (LIBRARY_CACHE_TIER=1).
+//
+// warm() copies every table into memory once; from then on reads are answered from memory,
+// while writes go to the backing storage first and are mirrored into memory only after the
+// backing write (or its transaction) succeeded. Writes are serialized by one mutex so the
+// memory copy sees them in the same order as the database. This assumes the server is the
+// only writer to the database.
+//
+// Inside a transaction, reads go to the backing session so they see the transaction's own
+// uncommitted writes; the mirrored changes are applied to memory in one step at commit().
+// A session leases its backing session (a pooled connection, for SQL) only when it first
+// needs one, so reads answered from memory never wait on the pool.
+
+class CachedStorage : public Storage {
+public:
+    explicit CachedStorage(std::unique_ptr<Storage> backing) : backing_(std::move(backing)) {}
+
+    const char* name() const override { return backing_->name(); }
+
+    std::unique_ptr<StorageSession> session() override {
+        return std::make_unique<Session>(*this);
+    }
+
+    // Loads every row of the backing storage; returns the number of books loaded
+    long long warm() {
+        MemoryStorage::Tables tables;
+        auto session = backing_->session();
+        session->books().scan({}, [&](const Book& book) { tables.books.emplace(book.book_id, book); });
+        session->readers().scan([&](const Reader& reader) { tables.readers.emplace(reader.reader_id, reader); });
+        session->records().scan([&](const Record& record) {
+            tables.records.emplace(MemoryStorage::RecordKey(record.book_id, record.reader_id), record);
+        });
+        const auto books = static_cast<long long>(tables.books.size());
+        cache_.apply([&](MemoryStorage::Tables& current) { current = std::move(tables); });
+        return books;
+    }
+
+private:
+    using Change = std::function<void(MemoryStorage::Tables&)>;
+
+    class Session;
+
+    // Shared plumbing for the three repositories: which side answers reads, and how a
+    // successful backing write reaches memory
+    class Tier {
+    public:
+        explicit Tier(Session& session) : session_(session) {}
+
+    protected:
+        StorageSession& reader() { return session_.in_transaction() ? session_.backing() : *session_.cache_; }
+
+        // Runs write against the backing session and, if it reports success, applies change to
+        // memory (or queues it until commit). write returns false for "no such row".
+        template <class Write>
+        bool mirror(Write&& write, Change change) {
+            // Leased before locking, so a wait on the pool does not hold up other writers
+            StorageSession& target = session_.backing();
+            std::unique_lock<std::mutex> lock(session_.storage_.write_mutex_, std::defer_lock);
+            if (!session_.in_transaction()) lock.lock();
+            if (!write(target)) return false;
+            session_.record(std::move(change));
+            return true;
+        }
+
+    private:
+        Session& session_;
+    };
+
+    class Books : public BookRepository, Tier {
+    public:
+        using Tier::Tier;
+
+        long long scan(const BookScan& scan, const RowSink<Book>& sink) override { return reader().books().scan(scan, sink); }
+        long long count() override { return reader().books().count(); }
+        std::optional<Book> find(const std::string& book_id) override { return reader().books().find(book_id); }
+
+        long long search(const BookSearchRequest& request, const RowSink<Book>& sink, std::vector<std::string>& plan) override {
+            return reader().books().search(request, sink, plan);
+        }
+
+        void insert(const Book& book) override {
+            mirror([&](StorageSession& target) { target.books().insert(book); return true; },
+                   [book](MemoryStorage::Tables& tables) { tables.books[book.book_id] = book; });
+        }
+
+        BulkInsertResult insert_many(const std::vector<Book>& books, size_t batch_size) override {
+            BulkInsertResult result;
+            // Filled by the backing write; shared because a transaction applies the change later
+            auto inserted = std::make_shared<std::vector<Book>>();
+            mirror(
+                [&](StorageSession& target) {
+                    result = target.books().insert_many(books, batch_size);
+                    std::vector<bool> skipped(books.size());
+                    for (size_t index : result.duplicates) skipped[index] = true;
+                    for (size_t i = 0; i < books.size(); ++i) {
+                        if (!skipped[i]) inserted->push_back(books[i]);
+                    }
+                    return true;
+                },
+                [inserted](MemoryStorage::Tables& tables) {
+                    for (const auto& book : *inserted) tables.books[book.book_id] = book;
+                });
+            return result;
+        }
+
+        bool update(const Book& book) override {
+            return mirror([&](StorageSession& target) { return target.books().update(book); },
+                          [book](MemoryStorage::Tables& tables) { tables.books[book.book_id] = book; });
+        }
+
+        bool remove(const std::string& book_id) override {
+            return mirror([&](StorageSession& target) { return target.books().remove(book_id); },
+                          [book_id](MemoryStorage::Tables& tables) { tables.books.erase(book_id); });
+        }
+    };
+
+    class Readers : public ReaderRepository, Tier {
+    public:
+        using Tier::Tier;
+
+        long long scan(const RowSink<Reader>& sink) override { return reader().readers().scan(sink); }
+        std::optional<Reader> find(const std::string& reader_id) override { return reader().readers().find(reader_id); }
+
+        void insert(const Reader& row) override {
+            mirror([&](StorageSession& target) { target.readers().insert(row); return true; },
+                   [row](MemoryStorage::Tables& tables) { tables.readers[row.reader_id] = row; });
+        }
+
+        bool update(const Reader& row) override {
+            return mirror([&](StorageSession& target) { return target.readers().update(row); },
+                          [row](MemoryStorage::Tables& tables) { tables.readers[row.reader_id] = row; });
+        }
+
+        bool remove(const std::string& reader_id) override {
+            return mirror([&](StorageSession& target) { return target.readers().remove(reader_id); },
+                          [reader_id](MemoryStorage::Tables& tables) { tables.readers.erase(reader_id); });
+        }
+    };
+
+    class Records : public RecordRepository, Tier {
+    public:
+        using Tier::Tier;
+
+        long long scan(const RowSink<Record>& sink) override { return reader().records().scan(sink); }
+
+        std::optional<Record> find(const std::string& book_id, const std::string& reader_id) override {
+            return reader().records().find(book_id, reader_id);
+        }
+
+        void insert(const Record& row) override {
+            mirror([&](StorageSession& target) { target.records().insert(row); return true; },
+                   [row](MemoryStorage::Tables& tables) { tables.records[MemoryStorage::RecordKey(row.book_id, row.reader_id)] = row; });
+        }
+
+        bool update(const Record& row) override {
+            return mirror([&](StorageSession& target) { return target.records().update(row); },
+                          [row](MemoryStorage::Tables& tables) { tables.records[MemoryStorage::RecordKey(row.book_id, row.reader_id)] = row; });
+        }
+
+        bool remove(const std::string& book_id, const std::string& reader_id) override {
+            return mirror([&](StorageSession& target) { return target.records().remove(book_id, reader_id); },
+                          [key = MemoryStorage::RecordKey(book_id, reader_id)](MemoryStorage::Tables& tables) { tables.records.erase(key); });
+        }
+    };
+
+    class Session : public StorageSession {
+    public:
+        explicit Session(CachedStorage& storage)
+            : storage_(storage), cache_(storage.cache_.session()),
+              books_(*this), readers_(*this), records_(*this) {}
+
+        // Destroying the backing session rolls back an unfinished transaction; done here so it
+        // happens while the write lock is still held
+        ~Session() override { backing_.reset(); }
+
+        BookRepository& books() override { return books_; }
+        ReaderRepository& readers() override { return readers_; }
+        RecordRepository& records() override { return records_; }
+
+        void begin() override {
+            if (transaction_lock_) return;
+            StorageSession& backing = this->backing();
+            transaction_lock_.emplace(storage_.write_mutex_);
+            backing.begin();
+            pending_.clear();
+        }
+
+        void commit() override {
+            if (!transaction_lock_) return;
+            backing_->commit();
+            std::vector<Change> pending = std::move(pending_);
+            storage_.cache_.apply([&](MemoryStorage::Tables& tables) {
+                for (auto& change : pending) change(tables);
+            });
+            pending_.clear();
+            transaction_lock_.reset();
+        }
+
+        void rollback() override {
+            if (!transaction_lock_) return;
+            pending_.clear();
+            backing_->rollback();
+            transaction_lock_.reset();
+        }
+
+        bool in_transaction() const { return transaction_lock_.has_value(); }
+
+        // The backing session, leased on first use
+        StorageSession& backing() {
+            if (!backing_) backing_ = storage_.backing_->session();
+            return *backing_;
+        }
+
+    private:
+        friend class Tier;
+
+        void record(Change change) {
+            if (in_transaction()) {
+                pending_.push_back(std::move(change));
+            } else {
+                storage_.cache_.apply(change);
+            }
+        }
+
+        CachedStorage& storage_;
+        std::unique_ptr<StorageSession> backing_;
+        std::unique_ptr<StorageSession> cache_;
+        std::optional<std::unique_lock<std::mutex>> transaction_lock_;
+        std::vector<Change> pending_;
+        Books books_;
+        Readers readers_;
+        Records records_;
+    };
+
+    std::unique_ptr<Storage> backing_;
+    MemoryStorage cache_;
+    std::mutex write_mutex_;
+};
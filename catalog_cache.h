@@ -0,0 +1,129 @@
+#pragma once
+
+#include "compression.h"
+#include "models.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Read-through cache for the book catalog.
+//
+// Holds the serialized GET /api/books body and individual Book rows. The body is kept plain
+// and in each content coding clients have asked for, so the catalog is compressed once per
+// change rather than once per request. Every write handler bumps the catalog version, which
+// drops the serialized lists and the written row; both are rebuilt on the next read. ETags are derived from the version, so a
+// client polling with If-None-Match gets a 304 without any database access.
+// Assumes this process is the only writer to the book table.
+class CatalogCache {
+public:
+    CatalogCache()
+        : epoch_(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch() / std::chrono::seconds(1))) {}
+
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    // Strong ETag for a catalog read at the given version; variant distinguishes query strings
+    std::string etag(uint64_t version, const std::string& variant = std::string()) const {
+        std::string tag = "\"" + std::to_string(epoch_) + "-" + std::to_string(version);
+        if (!variant.empty()) tag += "-" + std::to_string(std::hash<std::string>{}(variant));
+        tag += "\"";
+        return tag;
+    }
+
+    // True when an If-None-Match header lists tag (or is "*"). Compressed representations have
+    // tags of their own (etag_for_coding), so pass the tag of the coding about to be sent.
+    static bool matches(const std::string& if_none_match, const std::string& tag) {
+        if (if_none_match.empty()) return false;
+        if (if_none_match == "*") return true;
+        size_t pos = 0;
+        while (pos < if_none_match.size()) {
+            size_t end = if_none_match.find(',', pos);
+            if (end == std::string::npos) end = if_none_match.size();
+            std::string candidate = if_none_match.substr(pos, end - pos);
+            const auto first = candidate.find_first_not_of(' ');
+            const auto last = candidate.find_last_not_of(' ');
+            if (first != std::string::npos) candidate = candidate.substr(first, last - first + 1);
+            if (candidate.rfind("W/", 0) == 0) candidate.erase(0, 2);
+            if (candidate == tag) return true;
+            pos = end + 1;
+        }
+        return false;
+    }
+
+    struct Listing {
+        std::shared_ptr<const std::string> body;  // Null when nothing is cached
+        uint64_t version = 0;                     // Catalog version the body was built at
+    };
+
+    // Serialized full listing in coding, if one is cached for the current version
+    Listing listing(ContentCoding coding = ContentCoding::identity) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {list_bodies_[static_cast<size_t>(coding)], version_.load(std::memory_order_acquire)};
+    }
+
+    // Store a listing built from a read that started at read_version (dropped if a write happened
+    // since) and hand it back
+    std::shared_ptr<const std::string> store_list_body(uint64_t read_version, std::string body, ContentCoding coding = ContentCoding::identity) {
+        auto stored = std::make_shared<const std::string>(std::move(body));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (read_version == version_.load(std::memory_order_acquire)) list_bodies_[static_cast<size_t>(coding)] = stored;
+        return stored;
+    }
+
+    std::optional<Book> find_book(const std::string& book_id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = books_.find(book_id);
+        if (found == books_.end()) return std::nullopt;
+        return found->second;
+    }
+
+    void store_book(uint64_t read_version, const Book& book) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (read_version != version_.load(std::memory_order_acquire)) return;
+        books_[book.book_id] = book;
+    }
+
+    // Write hook, called after an insert/update/delete of book_id succeeded. The row entry is
+    // dropped rather than patched: two racing writers could otherwise leave the older value behind.
+    void on_write(const std::string& book_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bump_locked();
+        books_.erase(book_id);
+    }
+
+    // A write whose effect on individual rows is unknown
+    void invalidate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bump_locked();
+        books_.clear();
+    }
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t not_modified() const { return not_modified_.load(std::memory_order_relaxed); }
+    void record_hit() { hits_.fetch_add(1, std::memory_order_relaxed); }
+    void record_miss() { misses_.fetch_add(1, std::memory_order_relaxed); }
+    void record_not_modified() { not_modified_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    void bump_locked() {
+        version_.fetch_add(1, std::memory_order_acq_rel);
+        for (auto& body : list_bodies_) body.reset();
+    }
+
+    const uint64_t epoch_;
+    std::atomic<uint64_t> version_{1};
+    mutable std::mutex mutex_;
+    std::array<std::shared_ptr<const std::string>, content_coding_count> list_bodies_;
+    std::unordered_map<std::string, Book> books_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> not_modified_{0};
+};
@@ -0,0 +1,573 @@
+#pragma once
+
+#if __has_include(<crow.h>)
+#include <crow.h>
+#else
+#include "crow_all.h"
+#endif
+#include "bounded_queue.h"
+#include "connection_pool.h"
+#include "models.h"
+#include "repository.h"
+#include "sql_database.h"
+#include "utf8.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Server-side import of vendor catalogs (POST /api/imports).
+//
+// The request body runs through four stages on their own threads:
+//
+//   parse      CSV records or NDJSON lines -> raw text fields, batch_size rows per chunk
+//   validate   required fields and numeric columns -> Book, rejected rows are logged
+//   transcode  text fields to UTF-8 (Latin-1 input, or malformed UTF-8 replaced by U+FFFD)
+//   insert     BookRepository::insert_many, one transaction per chunk
+//
+// Stages hand chunks over through BoundedQueues of queue_depth chunks, so at most a few
+// chunks per stage are in flight however large the file is. Crow hands the handler the whole
+// body, which the import takes over by move; nothing else grows with the input. Progress
+// counters are atomics that GET /api/imports/<id> reads while the stages run.
+//
+// Each chunk commits on its own, so a failed import keeps the chunks before the failure.
+// Rows whose book_id already exists are counted as duplicates, not errors that stop the run.
+
+enum class ImportFormat { csv, ndjson };
+enum class ImportCharset { utf8, latin1 };
+
+struct ImportOptions {
+    ImportFormat format = ImportFormat::csv;
+    ImportCharset charset = ImportCharset::utf8;
+    size_t batch_size = 1000;  // Rows per chunk and per insert transaction
+    size_t queue_depth = 4;    // Chunks buffered between two stages
+    // Held from each chunk's begin() through its on_inserted call, so the caller can order
+    // those against its own writes (the server passes the search index's write mutex)
+    std::mutex* write_mutex = nullptr;
+};
+
+// A row that did not make it in, by line of the input (1-based)
+struct ImportRowError {
+    size_t line;
+    std::string message;
+};
+
+struct ImportProgress {
+    uint64_t id = 0;
+    std::string format;
+    std::string state;  // "running", "completed" or "failed"
+    std::string error;  // Why a failed import stopped
+    uint64_t bytes_total = 0;
+    uint64_t bytes_parsed = 0;
+    uint64_t rows_parsed = 0;
+    uint64_t rows_rejected = 0;
+    uint64_t rows_duplicate = 0;
+    uint64_t rows_inserted = 0;
+    uint64_t rows_transcoded = 0;  // Rows with text that had to be repaired or converted
+    double elapsed_seconds = 0.0;
+    double rows_per_sec = 0.0;
+    std::vector<ImportRowError> errors;  // The max_logged_errors rejections with the lowest lines, in line order
+};
+
+namespace catalog_import_detail {
+
+// Book fields in the order RawRow::fields holds them
+constexpr std::array<const char*, 7> field_names = {
+    "book_id", "book_name", "book_isbn", "book_author", "book_publisher", "interview_times", "book_price"};
+constexpr size_t required_fields = 5;  // The first five must be present
+
+constexpr size_t max_logged_errors = 100;
+
+struct RawRow {
+    size_t line = 0;
+    std::array<std::string, field_names.size()> fields;
+    uint8_t present = 0;  // Bit i set when fields[i] was in the input
+    std::string error;    // Set by the parser for rows it could not read
+};
+
+struct BookChunk {
+    std::vector<size_t> lines;
+    std::vector<Book> books;
+};
+
+inline int field_index(std::string_view name) {
+    while (!name.empty() && (name.front() == ' ' || name.front() == '\t')) name.remove_prefix(1);
+    while (!name.empty() && (name.back() == ' ' || name.back() == '\t' || name.back() == '\r')) name.remove_suffix(1);
+    for (size_t i = 0; i < field_names.size(); ++i) {
+        if (name == field_names[i]) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// Reads one RFC 4180 record starting at pos into fields and advances pos past its line end.
+// Quoted fields may contain commas, doubled quotes and line breaks; line counts the breaks
+// consumed. Returns false at the end of the input, and sets error for an unterminated quote.
+inline bool next_csv_record(std::string_view in, size_t& pos, std::vector<std::string>& fields, size_t& line,
+                            std::string& error) {
+    fields.clear();
+    error.clear();
+    if (pos >= in.size()) return false;
+
+    std::string field;
+    bool quoted = false;
+    bool after_quote = false;
+    while (pos < in.size()) {
+        const char c = in[pos++];
+        if (quoted) {
+            if (c == '"') {
+                if (pos < in.size() && in[pos] == '"') {
+                    field.push_back('"');
+                    ++pos;
+                } else {
+                    quoted = false;
+                    after_quote = true;
+                }
+            } else {
+                if (c == '\n') ++line;
+                field.push_back(c);
+            }
+        } else if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+            after_quote = false;
+        } else if (c == '\n' || c == '\r') {
+            if (c == '\r' && pos < in.size() && in[pos] == '\n') ++pos;
+            ++line;
+            fields.push_back(std::move(field));
+            return true;
+        } else if (c == '"' && field.empty() && !after_quote) {
+            quoted = true;
+        } else {
+            field.push_back(c);
+        }
+    }
+    if (quoted) error = "Unterminated quoted field";
+    fields.push_back(std::move(field));
+    return true;
+}
+
+inline void trim(std::string& value) {
+    size_t end = value.size();
+    while (end > 0 && (value[end - 1] == ' ' || value[end - 1] == '\t')) --end;
+    size_t begin = 0;
+    while (begin < end && (value[begin] == ' ' || value[begin] == '\t')) ++begin;
+    value.assign(value, begin, end - begin);
+}
+
+}  // namespace catalog_import_detail
+
+class CatalogImport {
+public:
+    // Called from the insert stage with the rows each chunk committed
+    using InsertedHandler = std::function<void(const std::vector<Book>&)>;
+
+    // Throws std::invalid_argument when a CSV header lacks a required column
+    CatalogImport(uint64_t id, std::string body, ImportOptions options, Storage& storage, InsertedHandler on_inserted)
+        : id_(id),
+          body_(std::move(body)),
+          options_(options),
+          storage_(storage),
+          on_inserted_(std::move(on_inserted)),
+          raw_(options.queue_depth),
+          valid_(options.queue_depth),
+          utf8_(options.queue_depth),
+          started_(std::chrono::steady_clock::now()) {
+        using namespace catalog_import_detail;
+        if (options_.batch_size == 0) options_.batch_size = 1;
+        std::string_view in(body_);
+        if (in.substr(0, 3) == "\xEF\xBB\xBF") pos_ = 3;  // UTF-8 byte order mark
+        bytes_total_ = body_.size();
+
+        if (options_.format == ImportFormat::csv) {
+            std::vector<std::string> header;
+            std::string error;
+            next_csv_record(in, pos_, header, line_, error);
+            uint8_t present = 0;
+            for (const auto& name : header) {
+                const int index = field_index(name);
+                columns_.push_back(index);
+                if (index >= 0) present |= static_cast<uint8_t>(1u << index);
+            }
+            for (size_t i = 0; i < required_fields; ++i) {
+                if (!(present & (1u << i))) {
+                    throw std::invalid_argument("CSV header is missing the " + std::string(field_names[i]) + " column");
+                }
+            }
+        }
+    }
+
+    CatalogImport(const CatalogImport&) = delete;
+    CatalogImport& operator=(const CatalogImport&) = delete;
+
+    // Stops the stages and waits for them
+    ~CatalogImport() {
+        fail("Import cancelled");
+        for (auto& stage : stages_) {
+            if (stage.joinable()) stage.join();
+        }
+    }
+
+    void start() {
+        stages_.emplace_back([this] { run_stage(&CatalogImport::parse_stage); });
+        stages_.emplace_back([this] { run_stage(&CatalogImport::validate_stage); });
+        stages_.emplace_back([this] { run_stage(&CatalogImport::transcode_stage); });
+        stages_.emplace_back([this] { run_stage(&CatalogImport::insert_stage); });
+    }
+
+    uint64_t id() const { return id_; }
+    bool running() const { return state_.load() == State::running; }
+
+    ImportProgress progress() const {
+        ImportProgress p;
+        p.id = id_;
+        p.format = options_.format == ImportFormat::csv ? "csv" : "ndjson";
+        const State state = state_.load();
+        p.state = state == State::running ? "running" : (state == State::completed ? "completed" : "failed");
+        p.bytes_total = bytes_total_;
+        p.bytes_parsed = bytes_parsed_.load(std::memory_order_relaxed);
+        p.rows_parsed = rows_parsed_.load(std::memory_order_relaxed);
+        p.rows_rejected = rows_rejected_.load(std::memory_order_relaxed);
+        p.rows_duplicate = rows_duplicate_.load(std::memory_order_relaxed);
+        p.rows_inserted = rows_inserted_.load(std::memory_order_relaxed);
+        p.rows_transcoded = rows_transcoded_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            p.error = error_;
+            p.errors = errors_;
+            const auto end = state == State::running ? std::chrono::steady_clock::now() : finished_;
+            p.elapsed_seconds = std::chrono::duration<double>(end - started_).count();
+        }
+        p.rows_per_sec = p.elapsed_seconds > 0 ? static_cast<double>(p.rows_inserted) / p.elapsed_seconds : 0.0;
+        return p;
+    }
+
+private:
+    enum class State { running, completed, failed };
+
+    using RawChunk = std::vector<catalog_import_detail::RawRow>;
+    using BookChunk = catalog_import_detail::BookChunk;
+
+    // Anything a stage throws, from bad_alloc to the on_inserted callback, fails the import
+    // instead of leaving its thread and terminating the server
+    void run_stage(void (CatalogImport::*stage)()) {
+        try {
+            (this->*stage)();
+        } catch (const std::exception& e) {
+            fail(std::string("Import failed: ") + e.what());
+        }
+    }
+
+    void parse_stage() {
+        using namespace catalog_import_detail;
+        const std::string_view in(body_);
+        RawChunk chunk;
+        chunk.reserve(options_.batch_size);
+        std::vector<std::string> values;
+        std::string error;
+
+        while (pos_ < in.size() && running()) {
+            RawRow row;
+            row.line = line_ + 1;
+            if (options_.format == ImportFormat::csv) {
+                if (!next_csv_record(in, pos_, values, line_, error)) break;
+                if (values.size() == 1 && values[0].empty() && error.empty()) continue;  // Blank line
+                row.error = error;
+                for (size_t i = 0; i < values.size() && i < columns_.size(); ++i) {
+                    if (columns_[i] < 0) continue;
+                    row.fields[columns_[i]] = std::move(values[i]);
+                    row.present |= static_cast<uint8_t>(1u << columns_[i]);
+                }
+            } else {
+                size_t end = in.find('\n', pos_);
+                if (end == std::string_view::npos) end = in.size();
+                std::string_view text = in.substr(pos_, end - pos_);
+                pos_ = end + 1;
+                ++line_;
+                if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+                if (text.find_first_not_of(" \t") == std::string_view::npos) continue;
+                read_ndjson(text, row);
+            }
+
+            bytes_parsed_.store(std::min<uint64_t>(pos_, bytes_total_), std::memory_order_relaxed);
+            rows_parsed_.fetch_add(1, std::memory_order_relaxed);
+            chunk.push_back(std::move(row));
+            if (chunk.size() == options_.batch_size) {
+                if (!raw_.push(std::move(chunk))) return;
+                chunk = RawChunk();
+                chunk.reserve(options_.batch_size);
+            }
+        }
+        if (!chunk.empty()) raw_.push(std::move(chunk));
+        bytes_parsed_.store(bytes_total_, std::memory_order_relaxed);
+        raw_.close();
+    }
+
+    static void read_ndjson(std::string_view text, catalog_import_detail::RawRow& row) {
+        using namespace catalog_import_detail;
+        auto json = crow::json::load(text.data(), text.size());
+        if (!json || json.t() != crow::json::type::Object) {
+            row.error = "Line is not a JSON object";
+            return;
+        }
+        for (size_t i = 0; i < field_names.size(); ++i) {
+            if (!json.has(field_names[i])) continue;
+            const auto& value = json[field_names[i]];
+            if (value.t() == crow::json::type::Null) continue;
+            if (value.t() == crow::json::type::String) {
+                row.fields[i] = value.s();
+            } else {
+                // Numbers (and anything else) keep their JSON text; validate decides
+                row.fields[i] = crow::json::wvalue(value).dump();
+            }
+            row.present |= static_cast<uint8_t>(1u << i);
+        }
+    }
+
+    void validate_stage() {
+        using namespace catalog_import_detail;
+        RawChunk raw;
+        while (raw_.pop(raw)) {
+            BookChunk chunk;
+            chunk.books.reserve(raw.size());
+            chunk.lines.reserve(raw.size());
+            for (auto& row : raw) {
+                Book book;
+                std::string error = row.error.empty() ? to_book(row, book) : row.error;
+                if (!error.empty()) {
+                    reject(row.line, std::move(error));
+                    continue;
+                }
+                chunk.lines.push_back(row.line);
+                chunk.books.push_back(std::move(book));
+            }
+            if (!chunk.books.empty() && !valid_.push(std::move(chunk))) break;
+        }
+        valid_.close();
+    }
+
+    // Empty on success, else why the row was rejected
+    static std::string to_book(catalog_import_detail::RawRow& row, Book& book) {
+        using namespace catalog_import_detail;
+        for (auto& field : row.fields) trim(field);
+        for (size_t i = 0; i < required_fields; ++i) {
+            if (!(row.present & (1u << i))) return "Missing required field: " + std::string(field_names[i]);
+        }
+        if (row.fields[0].empty()) return "book_id is empty";
+
+        book.interview_times = 0;
+        if (!row.fields[5].empty()) {
+            char* end = nullptr;
+            errno = 0;
+            const long value = std::strtol(row.fields[5].c_str(), &end, 10);
+            if (*end != '\0' || errno == ERANGE || value < 0 || value > INT32_MAX) return "interview_times is not a non-negative integer";
+            book.interview_times = static_cast<int>(value);
+        }
+        book.book_price = 0.0;
+        if (!row.fields[6].empty()) {
+            char* end = nullptr;
+            const double value = std::strtod(row.fields[6].c_str(), &end);
+            if (*end != '\0' || !(value >= 0.0)) return "book_price is not a non-negative number";
+            book.book_price = value;
+        }
+        book.book_id = std::move(row.fields[0]);
+        book.book_name = std::move(row.fields[1]);
+        book.book_isbn = std::move(row.fields[2]);
+        book.book_author = std::move(row.fields[3]);
+        book.book_publisher = std::move(row.fields[4]);
+        return {};
+    }
+
+    void transcode_stage() {
+        BookChunk chunk;
+        std::string buffer;
+        const auto convert = [&](std::string& value) {
+            buffer.clear();
+            bool changed;
+            if (options_.charset == ImportCharset::latin1) {
+                append_latin1_as_utf8(buffer, value);
+                changed = buffer.size() != value.size();
+            } else {
+                changed = !append_valid_utf8(buffer, value);
+            }
+            if (changed) value.swap(buffer);
+            return changed;
+        };
+
+        while (valid_.pop(chunk)) {
+            for (auto& book : chunk.books) {
+                bool changed = false;
+                for (std::string* field : {&book.book_id, &book.book_name, &book.book_isbn, &book.book_author, &book.book_publisher}) {
+                    changed |= convert(*field);
+                }
+                if (changed) rows_transcoded_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!utf8_.push(std::move(chunk))) break;
+        }
+        utf8_.close();
+    }
+
+    void insert_stage() {
+        try {
+            auto session = storage_.session();
+            BookChunk chunk;
+            std::vector<Book> inserted;
+            while (utf8_.pop(chunk)) {
+                std::unique_lock<std::mutex> ordered;
+                if (options_.write_mutex) ordered = std::unique_lock<std::mutex>(*options_.write_mutex);
+                session->begin();
+                const BulkInsertResult result = session->books().insert_many(chunk.books, options_.batch_size);
+                session->commit();
+
+                std::vector<bool> skipped(chunk.books.size());
+                for (size_t index : result.duplicates) {
+                    skipped[index] = true;
+                    reject(chunk.lines[index], "Book with ID " + chunk.books[index].book_id + " already exists.", true);
+                }
+                inserted.clear();
+                for (size_t i = 0; i < chunk.books.size(); ++i) {
+                    if (!skipped[i]) inserted.push_back(std::move(chunk.books[i]));
+                }
+                rows_inserted_.fetch_add(static_cast<uint64_t>(result.inserted), std::memory_order_relaxed);
+                if (on_inserted_ && !inserted.empty()) on_inserted_(inserted);
+            }
+            if (running()) finish(State::completed, {});
+        } catch (const SqlError& e) {
+            fail(std::string("Database insert failed: ") + e.what());
+        } catch (const PoolExhaustedError& e) {
+            fail(e.what());
+        }
+    }
+
+    void reject(size_t line, std::string message, bool duplicate = false) {
+        (duplicate ? rows_duplicate_ : rows_rejected_).fetch_add(1, std::memory_order_relaxed);
+        // Stages reject rows out of line order (validation runs ahead of the duplicate check), so
+        // keep the list sorted and drop the highest line once it is full
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (errors_.size() == catalog_import_detail::max_logged_errors) {
+            if (line > errors_.back().line) return;
+            errors_.pop_back();
+        }
+        const auto at = std::upper_bound(errors_.begin(), errors_.end(), line,
+                                         [](size_t l, const ImportRowError& e) { return l < e.line; });
+        errors_.insert(at, {line, std::move(message)});
+    }
+
+    // Stops every stage: closed queues make blocked pushes and pops return
+    void fail(const std::string& error) {
+        if (finish(State::failed, error)) {
+            raw_.close();
+            valid_.close();
+            utf8_.close();
+        }
+    }
+
+    bool finish(State state, const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        State expected = State::running;
+        if (!state_.compare_exchange_strong(expected, state)) return false;
+        error_ = error;
+        finished_ = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    const uint64_t id_;
+    const std::string body_;
+    ImportOptions options_;
+    Storage& storage_;
+    InsertedHandler on_inserted_;
+
+    // Parser position; only the parse stage touches these after construction
+    size_t pos_ = 0;
+    size_t line_ = 0;
+    std::vector<int> columns_;  // CSV column -> field index, -1 for ignored columns
+
+    BoundedQueue<RawChunk> raw_;
+    BoundedQueue<BookChunk> valid_;
+    BoundedQueue<BookChunk> utf8_;
+
+    std::atomic<State> state_{State::running};
+    uint64_t bytes_total_ = 0;
+    std::atomic<uint64_t> bytes_parsed_{0};
+    std::atomic<uint64_t> rows_parsed_{0};
+    std::atomic<uint64_t> rows_rejected_{0};
+    std::atomic<uint64_t> rows_duplicate_{0};
+    std::atomic<uint64_t> rows_inserted_{0};
+    std::atomic<uint64_t> rows_transcoded_{0};
+
+    mutable std::mutex mutex_;
+    std::string error_;
+    std::vector<ImportRowError> errors_;
+    const std::chrono::steady_clock::time_point started_;
+    std::chrono::steady_clock::time_point finished_;
+
+    std::vector<std::thread> stages_;  // Last member: joined before anything above is destroyed
+};
+
+// Running and recently finished imports, by id
+class ImportRegistry {
+public:
+    explicit ImportRegistry(size_t max_running = 1, size_t keep_finished = 16)
+        : max_running_(max_running), keep_finished_(keep_finished) {}
+
+    // nullptr when max_running imports are already running; throws like CatalogImport
+    std::shared_ptr<CatalogImport> start(std::string body, ImportOptions options, Storage& storage,
+                                         CatalogImport::InsertedHandler on_inserted) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t running = 0;
+        for (const auto& entry : imports_) running += entry.second->running() ? 1 : 0;
+        if (running >= max_running_) return nullptr;
+
+        auto job = std::make_shared<CatalogImport>(next_id_, std::move(body), options, storage, std::move(on_inserted));
+        ++next_id_;
+        imports_.emplace(job->id(), job);
+        evict_locked();
+        job->start();
+        return job;
+    }
+
+    std::shared_ptr<CatalogImport> find(uint64_t id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = imports_.find(id);
+        return found == imports_.end() ? nullptr : found->second;
+    }
+
+    std::vector<std::shared_ptr<CatalogImport>> list() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::shared_ptr<CatalogImport>> jobs;
+        for (const auto& entry : imports_) jobs.push_back(entry.second);
+        return jobs;
+    }
+
+private:
+    // Drops the oldest finished imports beyond keep_finished
+    void evict_locked() {
+        size_t finished = 0;
+        for (const auto& entry : imports_) finished += entry.second->running() ? 0 : 1;
+        for (auto it = imports_.begin(); it != imports_.end() && finished > keep_finished_;) {
+            if (!it->second->running()) {
+                it = imports_.erase(it);
+                --finished;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    const size_t max_running_;
+    const size_t keep_finished_;
+    mutable std::mutex mutex_;
+    uint64_t next_id_ = 1;
+    std::map<uint64_t, std::shared_ptr<CatalogImport>> imports_;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#if LIBRARY_WITH_ZLIB
+#include <zlib.h>
+#endif
+#if LIBRARY_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// HTTP response compression (Content-Encoding).
+//
+// negotiate_coding() reads the client's Accept-Encoding and picks the coding to send: the one
+// with the highest q-value among those on offer, zstd before gzip before deflate on a tie.
+// What this build can produce depends on its libraries (gzip and deflate need zlib, zstd needs
+// libzstd); precompressed files offer whatever variants sit next to them. compress_body()
+// encodes a whole body in one call; responses are complete strings by the time they are sent.
+// "deflate" is the zlib format (RFC 9110), not raw deflate.
+
+enum class ContentCoding : uint8_t { identity, gzip, deflate, zstd };
+
+constexpr size_t content_coding_count = 4;
+constexpr const char* content_coding_names[content_coding_count] = {"identity", "gzip", "deflate", "zstd"};
+
+struct CompressionOptions {
+    size_t min_bytes = 1024;  // Smaller bodies are sent as they are; the headers would eat the saving
+    int zlib_level = 6;       // 1 (fastest) to 9 (smallest), for gzip and deflate
+    int zstd_level = 3;
+};
+
+constexpr bool coding_available(ContentCoding coding) {
+    switch (coding) {
+    case ContentCoding::identity:
+        return true;
+    case ContentCoding::gzip:
+    case ContentCoding::deflate:
+#if LIBRARY_WITH_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case ContentCoding::zstd:
+#if LIBRARY_WITH_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+// Coding to send for an Accept-Encoding header, out of the codings offered (indexed by
+// ContentCoding); identity when the client lists none of them
+inline ContentCoding negotiate_coding(std::string_view accept_encoding, const std::array<bool, content_coding_count>& offered) {
+    // q-values in thousandths; -1 for codings the header does not mention
+    std::array<int, content_coding_count> q;
+    q.fill(-1);
+    int any = -1;
+    size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        size_t end = accept_encoding.find(',', pos);
+        if (end == std::string_view::npos) end = accept_encoding.size();
+        std::string_view item = accept_encoding.substr(pos, end - pos);
+        pos = end + 1;
+
+        int weight = 1000;
+        const size_t semicolon = item.find(';');
+        if (semicolon != std::string_view::npos) {
+            std::string_view params = item.substr(semicolon + 1);
+            item = item.substr(0, semicolon);
+            const size_t equals = params.find('=');
+            if (equals != std::string_view::npos) {
+                const std::string value(params.substr(equals + 1));
+                weight = static_cast<int>(std::strtod(value.c_str(), nullptr) * 1000.0 + 0.5);
+            }
+        }
+        std::string token;
+        for (const char c : item) {
+            if (c != ' ' && c != '\t') token.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+        }
+        if (token == "*") {
+            any = weight;
+        } else if (token == "gzip" || token == "x-gzip") {
+            q[static_cast<size_t>(ContentCoding::gzip)] = weight;
+        } else if (token == "deflate") {
+            q[static_cast<size_t>(ContentCoding::deflate)] = weight;
+        } else if (token == "zstd") {
+            q[static_cast<size_t>(ContentCoding::zstd)] = weight;
+        }
+    }
+
+    ContentCoding best = ContentCoding::identity;
+    int best_q = 0;
+    for (const ContentCoding coding : {ContentCoding::zstd, ContentCoding::gzip, ContentCoding::deflate}) {
+        if (!offered[static_cast<size_t>(coding)]) continue;
+        int weight = q[static_cast<size_t>(coding)];
+        if (weight < 0) weight = any;
+        if (weight > best_q) {
+            best = coding;
+            best_q = weight;
+        }
+    }
+    return best;
+}
+
+// Coding to send for an Accept-Encoding header, out of those this build can produce
+inline ContentCoding negotiate_coding(std::string_view accept_encoding) {
+    static constexpr std::array<bool, content_coding_count> available = {
+        coding_available(ContentCoding::identity), coding_available(ContentCoding::gzip),
+        coding_available(ContentCoding::deflate), coding_available(ContentCoding::zstd)};
+    return negotiate_coding(accept_encoding, available);
+}
+
+// Content types worth compressing: text, JSON (including NDJSON), JavaScript, XML and CSV.
+// An empty type is Crow's plain-text default.
+inline bool compressible_type(std::string_view content_type) {
+    return content_type.empty() || content_type.rfind("text/", 0) == 0 || content_type.find("json") != std::string_view::npos ||
+           content_type.find("javascript") != std::string_view::npos || content_type.find("xml") != std::string_view::npos ||
+           content_type.find("csv") != std::string_view::npos;
+}
+
+// body encoded with coding; throws std::runtime_error when the codec fails
+inline std::string compress_body(ContentCoding coding, std::string_view body, const CompressionOptions& options) {
+    std::string out;
+    switch (coding) {
+    case ContentCoding::identity:
+        out.assign(body);
+        return out;
+    case ContentCoding::gzip:
+    case ContentCoding::deflate: {
+#if LIBRARY_WITH_ZLIB
+        if (body.size() > UINT_MAX) throw std::runtime_error("Body too large to compress");
+        z_stream stream{};
+        // 15-bit window; +16 writes a gzip header and trailer instead of zlib's
+        const int window_bits = coding == ContentCoding::gzip ? 15 + 16 : 15;
+        if (deflateInit2(&stream, options.zlib_level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Cannot start zlib compression");
+        }
+        out.resize(deflateBound(&stream, static_cast<uLong>(body.size())));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = static_cast<uInt>(out.size());
+        const int result = deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (result != Z_STREAM_END) throw std::runtime_error("zlib compression failed");
+        return out;
+#else
+        break;
+#endif
+    }
+    case ContentCoding::zstd: {
+#if LIBRARY_WITH_ZSTD
+        out.resize(ZSTD_compressBound(body.size()));
+        const size_t written = ZSTD_compress(out.data(), out.size(), body.data(), body.size(), options.zstd_level);
+        if (ZSTD_isError(written)) throw std::runtime_error(ZSTD_getErrorName(written));
+        out.resize(written);
+        return out;
+#else
+        break;
+#endif
+    }
+    }
+    (void)options;
+    throw std::runtime_error(std::string("This server was built without ") + content_coding_names[static_cast<size_t>(coding)] + " support");
+}
+
+// Strong ETag of the coding's representation: "<tag>+gzip". A 304 names the same tag as the 200
+// it confirms, so conditional requests are checked against the tag of the negotiated coding.
+inline std::string etag_for_coding(const std::string& etag, ContentCoding coding) {
+    if (coding == ContentCoding::identity || etag.size() < 2 || etag.back() != '"') return etag;
+    return etag.substr(0, etag.size() - 1) + "+" + content_coding_names[static_cast<size_t>(coding)] + "\"";
+}
+
+// Responses sent compressed and the bytes compressed, per coding, for /metrics
+class CompressionCounters {
+public:
+    void record_response(ContentCoding coding) { responses_[index(coding)].fetch_add(1, std::memory_order_relaxed); }
+
+    void record_encode(ContentCoding coding, size_t bytes_in, size_t bytes_out) {
+        bytes_in_[index(coding)].fetch_add(bytes_in, std::memory_order_relaxed);
+        bytes_out_[index(coding)].fetch_add(bytes_out, std::memory_order_relaxed);
+    }
+
+    uint64_t responses(ContentCoding coding) const { return responses_[index(coding)].load(std::memory_order_relaxed); }
+    uint64_t bytes_in(ContentCoding coding) const { return bytes_in_[index(coding)].load(std::memory_order_relaxed); }
+    uint64_t bytes_out(ContentCoding coding) const { return bytes_out_[index(coding)].load(std::memory_order_relaxed); }
+
+private:
+    static size_t index(ContentCoding coding) { return static_cast<size_t>(coding); }
+
+    std::array<std::atomic<uint64_t>, content_coding_count> responses_{};
+    std::array<std::atomic<uint64_t>, content_coding_count> bytes_in_{};
+    std::array<std::atomic<uint64_t>, content_coding_count> bytes_out_{};
+};
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Thrown by get_connection() when no connection frees up before the acquire timeout
+class PoolExhaustedError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct PoolOptions {
+    size_t max_size = 5;                                   // Hard cap on open connections
+    size_t min_size = 5;                                   // Kept open by the maintenance thread
+    std::chrono::milliseconds acquire_timeout{5000};       // How long a checkout may wait for a free slot
+    std::chrono::milliseconds validate_after_idle{30000};  // Idle connections older than this are validated first
+    std::chrono::milliseconds maintenance_interval{1000};  // Reconnect / probe / rate sampling period
+};
+
+// Upper bounds (in microseconds) of the checkout wait histogram buckets; the last bucket is +Inf
+constexpr std::array<uint64_t, 9> pool_wait_buckets_us = {
+    100, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000
+};
+
+struct PoolStats {
+    size_t max_size = 0;
+    size_t open = 0;
+    size_t idle = 0;
+    size_t in_use = 0;
+    size_t waiting = 0;
+    uint64_t checkouts_total = 0;
+    double checkouts_per_sec = 0.0;
+    uint64_t exhaustion_events = 0;
+    uint64_t connect_failures = 0;
+    uint64_t validation_failures = 0;
+    uint64_t discarded = 0;
+    uint64_t wait_time_total_us = 0;
+    std::array<uint64_t, pool_wait_buckets_us.size() + 1> wait_histogram{};
+};
+
+template <typename Connection>
+class BasicConnectionPool;
+
+// Scoped checkout of a pooled connection.
+// Move-only; the destructor hands the connection back on every exit path. A lease released
+// while an exception is unwinding is returned as suspect, so it gets validated before reuse,
+// and one marked broken is closed instead of being pooled.
+template <typename Connection>
+class ConnectionLease {
+public:
+    ConnectionLease() = default;
+    ConnectionLease(BasicConnectionPool<Connection>* pool, std::unique_ptr<Connection> conn)
+        : pool_(pool), conn_(std::move(conn)), uncaught_on_entry_(std::uncaught_exceptions()) {}
+
+    ConnectionLease(ConnectionLease&& other) noexcept
+        : pool_(other.pool_), conn_(std::move(other.conn_)),
+          broken_(other.broken_), uncaught_on_entry_(other.uncaught_on_entry_) {
+        other.pool_ = nullptr;
+    }
+
+    ConnectionLease& operator=(ConnectionLease&& other) noexcept {
+        if (this != &other) {
+            release();
+            pool_ = other.pool_;
+            conn_ = std::move(other.conn_);
+            broken_ = other.broken_;
+            uncaught_on_entry_ = other.uncaught_on_entry_;
+            other.pool_ = nullptr;
+        }
+        return *this;
+    }
+
+    ConnectionLease(const ConnectionLease&) = delete;
+    ConnectionLease& operator=(const ConnectionLease&) = delete;
+
+    ~ConnectionLease() { release(); }
+
+    Connection& operator*() const { return *conn_; }
+    Connection* operator->() const { return conn_.get(); }
+    Connection* get() const { return conn_.get(); }
+    explicit operator bool() const { return conn_ != nullptr; }
+
+    // The connection is known to be unusable (e.g. a communication link failure)
+    void mark_broken() { broken_ = true; }
+
+    // Give the connection back early; safe to call more than once
+    void release() noexcept {
+        if (!pool_ || !conn_) return;
+        if (broken_) {
+            pool_->discard_connection(std::move(conn_));
+        } else if (std::uncaught_exceptions() > uncaught_on_entry_) {
+            pool_->return_suspect(std::move(conn_));
+        } else {
+            pool_->return_connection(std::move(conn_));
+        }
+        pool_ = nullptr;
+    }
+
+private:
+    BasicConnectionPool<Connection>* pool_ = nullptr;
+    std::unique_ptr<Connection> conn_;
+    bool broken_ = false;
+    int uncaught_on_entry_ = 0;
+};
+
+// Bounded connection pool.
+// At most max_size connections are ever open; callers block on a condition variable
+// (up to acquire_timeout) instead of opening extra logins when the pool is drained.
+// A background thread reconnects slots freed by dead connections and probes stale idle ones.
+template <typename Connection>
+class BasicConnectionPool {
+public:
+    using Factory = std::function<std::unique_ptr<Connection>()>;
+    using Validator = std::function<bool(Connection&)>;
+
+    BasicConnectionPool(Factory factory, Validator validator, PoolOptions options = {})
+        : factory_(std::move(factory)), validator_(std::move(validator)), options_(options) {
+        if (options_.max_size == 0) options_.max_size = 1;
+        if (options_.min_size > options_.max_size) options_.min_size = options_.max_size;
+
+        for (size_t i = 0; i < options_.min_size; ++i) {
+            try {
+                idle_.push_back({factory_(), clock::now()});
+                ++open_;
+            } catch (const std::exception& e) {
+                ++connect_failures_;
+                std::cerr << "Error creating connection for pool: " << e.what() << std::endl;
+            }
+        }
+        maintenance_ = std::thread([this] { maintain(); });
+    }
+
+    ~BasicConnectionPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        maintenance_cv_.notify_all();
+        available_.notify_all();
+        if (maintenance_.joinable()) maintenance_.join();
+    }
+
+    BasicConnectionPool(const BasicConnectionPool&) = delete;
+    BasicConnectionPool& operator=(const BasicConnectionPool&) = delete;
+
+    // Scoped checkout; prefer this over get_connection()/return_connection() pairs
+    ConnectionLease<Connection> acquire() {
+        return ConnectionLease<Connection>(this, get_connection());
+    }
+
+    // Check out a connection, waiting up to acquire_timeout for one to be returned.
+    // Throws PoolExhaustedError on timeout, or whatever the factory throws if a new login fails.
+    std::unique_ptr<Connection> get_connection() {
+        const auto start = clock::now();
+        const auto deadline = start + options_.acquire_timeout;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            if (stopping_) throw PoolExhaustedError("Connection pool is shutting down");
+
+            if (!idle_.empty()) {
+                IdleConnection entry = std::move(idle_.back());
+                idle_.pop_back();
+                lock.unlock();
+
+                if (!needs_validation(entry, clock::now()) || !validator_ || validator_(*entry.conn)) {
+                    record_checkout(start);
+                    return std::move(entry.conn);
+                }
+
+                ++validation_failures_;
+                entry.conn.reset();
+                lock.lock();
+                --open_;
+                maintenance_cv_.notify_one();
+                continue;
+            }
+
+            if (open_ < options_.max_size) {
+                ++open_;
+                lock.unlock();
+                std::unique_ptr<Connection> conn;
+                try {
+                    conn = factory_();
+                } catch (...) {
+                    ++connect_failures_;
+                    release_slot();
+                    throw;
+                }
+                record_checkout(start);
+                return conn;
+            }
+
+            ++waiting_;
+            const bool signalled = available_.wait_until(lock, deadline, [this] {
+                return stopping_ || !idle_.empty() || open_ < options_.max_size;
+            });
+            --waiting_;
+            if (!signalled) {
+                ++exhaustion_events_;
+                record_wait(clock::now() - start);
+                throw PoolExhaustedError("Timed out waiting for a database connection");
+            }
+        }
+    }
+
+    // Hand a connection back. A null pointer releases the slot so the maintenance thread can reconnect it.
+    void return_connection(std::unique_ptr<Connection> conn) {
+        if (!conn) {
+            release_slot();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.push_back({std::move(conn), clock::now()});
+        }
+        available_.notify_one();
+    }
+
+    // Return a connection that was in use when an error escaped; it is validated before the next checkout
+    void return_suspect(std::unique_ptr<Connection> conn) {
+        if (!conn) {
+            release_slot();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.push_back({std::move(conn), clock::now(), true});
+        }
+        available_.notify_one();
+    }
+
+    // Close a broken connection instead of returning it to the idle list
+    void discard_connection(std::unique_ptr<Connection> conn) {
+        ++discarded_;
+        conn.reset();
+        release_slot();
+    }
+
+    PoolStats stats() const {
+        PoolStats s;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            s.max_size = options_.max_size;
+            s.open = open_;
+            s.idle = idle_.size();
+            s.in_use = open_ - idle_.size();
+            s.waiting = waiting_;
+            s.checkouts_per_sec = checkouts_per_sec_;
+        }
+        s.checkouts_total = checkouts_total_.load(std::memory_order_relaxed);
+        s.exhaustion_events = exhaustion_events_.load(std::memory_order_relaxed);
+        s.connect_failures = connect_failures_.load(std::memory_order_relaxed);
+        s.validation_failures = validation_failures_.load(std::memory_order_relaxed);
+        s.discarded = discarded_.load(std::memory_order_relaxed);
+        s.wait_time_total_us = wait_time_total_us_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < s.wait_histogram.size(); ++i) {
+            s.wait_histogram[i] = wait_histogram_[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    const PoolOptions& options() const { return options_; }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct IdleConnection {
+        std::unique_ptr<Connection> conn;
+        clock::time_point since;
+        bool suspect = false;
+    };
+
+    bool needs_validation(const IdleConnection& entry, clock::time_point now) const {
+        return entry.suspect || now - entry.since >= options_.validate_after_idle;
+    }
+
+    void release_slot() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --open_;
+        }
+        available_.notify_one();
+        maintenance_cv_.notify_one();
+    }
+
+    void record_checkout(clock::time_point start) {
+        checkouts_total_.fetch_add(1, std::memory_order_relaxed);
+        record_wait(clock::now() - start);
+    }
+
+    void record_wait(clock::duration waited) {
+        const auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(waited).count());
+        wait_time_total_us_.fetch_add(us, std::memory_order_relaxed);
+        size_t bucket = 0;
+        while (bucket < pool_wait_buckets_us.size() && us > pool_wait_buckets_us[bucket]) ++bucket;
+        wait_histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Background loop: samples the checkout rate, re-validates stale idle connections
+    // and reopens slots left empty by dead or failed connections.
+    void maintain() {
+        auto last_tick = clock::now();
+        uint64_t last_checkouts = checkouts_total_.load(std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            maintenance_cv_.wait_for(lock, options_.maintenance_interval);
+            if (stopping_) break;
+
+            const auto now = clock::now();
+            if (now - last_tick >= options_.maintenance_interval) {
+                const uint64_t checkouts = checkouts_total_.load(std::memory_order_relaxed);
+                const double seconds = std::chrono::duration<double>(now - last_tick).count();
+                checkouts_per_sec_ = static_cast<double>(checkouts - last_checkouts) / seconds;
+                last_checkouts = checkouts;
+                last_tick = now;
+                probe_stale(lock);
+            }
+            refill(lock);
+        }
+    }
+
+    // Validate idle connections that have not been used for a while, off the request path
+    void probe_stale(std::unique_lock<std::mutex>& lock) {
+        std::vector<IdleConnection> stale;
+        const auto now = clock::now();
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            if (needs_validation(*it, now)) {
+                stale.push_back(std::move(*it));
+                it = idle_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (stale.empty()) return;
+
+        lock.unlock();
+        std::vector<IdleConnection> healthy;
+        for (auto& entry : stale) {
+            if (!validator_ || validator_(*entry.conn)) {
+                healthy.push_back({std::move(entry.conn), clock::now()});
+            } else {
+                ++validation_failures_;
+            }
+        }
+        const size_t dead = stale.size() - healthy.size();
+        stale.clear();
+        lock.lock();
+
+        open_ -= dead;
+        for (auto& entry : healthy) idle_.push_back(std::move(entry));
+        available_.notify_all();
+    }
+
+    // Reopen connections until min_size is reached again; gives up until the next tick on failure
+    void refill(std::unique_lock<std::mutex>& lock) {
+        while (!stopping_ && open_ < options_.min_size) {
+            ++open_;
+            lock.unlock();
+            std::unique_ptr<Connection> conn;
+            try {
+                conn = factory_();
+            } catch (const std::exception& e) {
+                ++connect_failures_;
+                std::cerr << "Pool reconnect failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+            if (!conn) {
+                --open_;
+                return;
+            }
+            idle_.push_back({std::move(conn), clock::now()});
+            available_.notify_one();
+        }
+    }
+
+    Factory factory_;
+    Validator validator_;
+    PoolOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::condition_variable maintenance_cv_;
+    std::vector<IdleConnection> idle_;
+    size_t open_ = 0;     // Idle + checked out + currently being opened
+    size_t waiting_ = 0;
+    bool stopping_ = false;
+    double checkouts_per_sec_ = 0.0;
+    std::thread maintenance_;
+
+    std::atomic<uint64_t> checkouts_total_{0};
+    std::atomic<uint64_t> exhaustion_events_{0};
+    std::atomic<uint64_t> connect_failures_{0};
+    std::atomic<uint64_t> validation_failures_{0};
+    std::atomic<uint64_t> discarded_{0};
+    std::atomic<uint64_t> wait_time_total_us_{0};
+    std::array<std::atomic<uint64_t>, pool_wait_buckets_us.size() + 1> wait_histogram_{};
+};
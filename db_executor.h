@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ExecutorOptions {
+    size_t threads = 5;        // Workers running database calls; more than the pool size only wait on the pool
+    size_t queue_limit = 256;  // Jobs that may wait for a worker before submit() turns new ones away
+};
+
+struct ExecutorStats {
+    size_t threads = 0;
+    size_t busy = 0;
+    size_t queued = 0;
+    size_t queue_limit = 0;
+    uint64_t completed = 0;
+    uint64_t rejected = 0;
+};
+
+// Fixed set of threads for blocking database work, fed from a bounded FIFO queue.
+// Crow's I/O threads hand requests that touch the database over and go back to serving
+// sockets, so slow queries wait here instead of occupying every I/O thread. When the queue is
+// full submit() refuses the job, and the caller answers 503 rather than queueing without bound.
+class DbExecutor {
+public:
+    explicit DbExecutor(ExecutorOptions options) : options_(options) {
+        if (options_.threads == 0) options_.threads = 1;
+        workers_.reserve(options_.threads);
+        for (size_t i = 0; i < options_.threads; ++i) workers_.emplace_back([this] { run(); });
+    }
+
+    // Runs what is already queued, then joins the workers
+    ~DbExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    // Queues job for a worker; false when the queue is full or the executor is stopping
+    bool submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || queue_.size() >= options_.queue_limit) {
+                ++rejected_;
+                return false;
+            }
+            queue_.push_back(std::move(job));
+        }
+        ready_.notify_one();
+        return true;
+    }
+
+    ExecutorStats stats() const {
+        ExecutorStats s;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            s.queued = queue_.size();
+            s.rejected = rejected_;
+        }
+        s.threads = options_.threads;
+        s.busy = busy_.load(std::memory_order_relaxed);
+        s.queue_limit = options_.queue_limit;
+        s.completed = completed_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            busy_.fetch_add(1, std::memory_order_relaxed);
+            job();
+            busy_.fetch_sub(1, std::memory_order_relaxed);
+            completed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ExecutorOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_ = false;
+    uint64_t rejected_ = 0;
+    std::atomic<size_t> busy_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::vector<std::thread> workers_;
+};
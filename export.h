@@ -0,0 +1,339 @@
+#pragma once
+
+#include "models.h"
+#include "repository.h"
+#include "row_json.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#if LIBRARY_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// Whole-table exports (GET /api/export/<table>).
+//
+// Rows come from a repository scan, which is a forward-only cursor, and are encoded one at a
+// time into an ExportSpool: a temporary file, written through a 64 KB buffer and optionally
+// zstd-compressed on the way. Memory stays flat however big the table is, and the database
+// connection is released as soon as the scan ends, so a slow client never holds a connection.
+// The handler then sends the file with Crow's static-file writer (sendfile() on Linux), which
+// writes synchronously on the connection's I/O thread: a slow client blocks that thread, and
+// the other connections it serves, until the download finishes or stalls for 30 s. Crow has
+// no API for writing a response body piece by piece (chunked encoding), so spooling is the
+// closest fit to streaming that it supports.
+//
+// Formats:
+//   ndjson    one JSON object per line, same keys as the REST API
+//   csv       RFC 4180 with a header row; NULL is an empty field
+//   columnar  the compact binary layout below
+//
+// Columnar layout (all integers are unsigned LEB128 varints unless noted):
+//   magic     "LMCOL1\n"
+//   columns   count, then per column: name length, name bytes, type byte
+//             (1 int64 zigzag varint, 2 float64 little-endian, 3 UTF-8 text, 4 nullable text)
+//   blocks    row count (0 ends the stream), then per column: segment byte length, segment
+//             int64:         row count zigzag varints
+//             float64:       row count 8-byte values
+//             text:          row count lengths, then the bytes
+//             nullable text: ceil(rows / 8) null bitmap bytes (bit set = NULL, LSB first),
+//                            lengths of the non-NULL values, then their bytes
+//   Blocks hold up to columnar_block_rows rows.
+
+enum class ExportFormat { ndjson, csv, columnar };
+
+constexpr size_t columnar_block_rows = 4096;
+
+// Temporary file an export is encoded into; deleted by the destructor
+class ExportSpool {
+public:
+    ExportSpool(const std::filesystem::path& dir, bool zstd, int zstd_level = 3) {
+        static std::atomic<uint64_t> counter{0};
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        path_ = (dir / ("library-export-" + std::to_string(stamp) + "-" + std::to_string(counter++) + ".bin")).string();
+        file_ = std::fopen(path_.c_str(), "wbx");
+        if (!file_) throw std::runtime_error("Cannot create export spool file " + path_);
+        buffer_.reserve(flush_threshold + 1024);
+#if LIBRARY_WITH_ZSTD
+        if (zstd) {
+            zstd_ = ZSTD_createCStream();
+            if (!zstd_ || ZSTD_isError(ZSTD_initCStream(zstd_, zstd_level))) {
+                close();
+                throw std::runtime_error("Cannot start zstd compression");
+            }
+            compressed_.resize(ZSTD_CStreamOutSize());
+        }
+#else
+        (void)zstd;
+        (void)zstd_level;
+#endif
+    }
+
+    ExportSpool(const ExportSpool&) = delete;
+    ExportSpool& operator=(const ExportSpool&) = delete;
+
+    ~ExportSpool() {
+        close();
+        std::error_code ignored;
+        std::filesystem::remove(path_, ignored);
+    }
+
+    // Encoders append here, then call flush_if_full()
+    std::string& buffer() { return buffer_; }
+
+    void flush_if_full() {
+        if (buffer_.size() >= flush_threshold) flush(false);
+    }
+
+    // Writes what is left (and the end of the zstd frame) and closes the file
+    void finish() {
+        flush(true);
+        if (std::fclose(file_) != 0) {
+            file_ = nullptr;
+            throw std::runtime_error("Export spool write failed");
+        }
+        file_ = nullptr;
+    }
+
+    const std::string& path() const { return path_; }
+    uint64_t encoded_bytes() const { return encoded_bytes_; }
+    uint64_t file_bytes() const { return file_bytes_; }
+
+private:
+    static constexpr size_t flush_threshold = 64 * 1024;
+
+    void flush(bool last) {
+        encoded_bytes_ += buffer_.size();
+#if LIBRARY_WITH_ZSTD
+        if (zstd_) {
+            ZSTD_inBuffer in{buffer_.data(), buffer_.size(), 0};
+            size_t remaining;
+            do {
+                ZSTD_outBuffer out{compressed_.data(), compressed_.size(), 0};
+                remaining = last ? ZSTD_compressStream2(zstd_, &out, &in, ZSTD_e_end)
+                                 : ZSTD_compressStream2(zstd_, &out, &in, ZSTD_e_continue);
+                if (ZSTD_isError(remaining)) throw std::runtime_error(ZSTD_getErrorName(remaining));
+                write(compressed_.data(), out.pos);
+            } while (last ? remaining != 0 : in.pos < in.size);
+            buffer_.clear();
+            return;
+        }
+#else
+        (void)last;
+#endif
+        write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    void write(const char* data, size_t size) {
+        if (size == 0) return;
+        if (std::fwrite(data, 1, size, file_) != size) throw std::runtime_error("Export spool write failed");
+        file_bytes_ += size;
+    }
+
+    void close() {
+#if LIBRARY_WITH_ZSTD
+        if (zstd_) ZSTD_freeCStream(zstd_);
+        zstd_ = nullptr;
+#endif
+        if (file_) std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    std::string buffer_;
+    uint64_t encoded_bytes_ = 0;
+    uint64_t file_bytes_ = 0;
+#if LIBRARY_WITH_ZSTD
+    ZSTD_CStream* zstd_ = nullptr;
+    std::vector<char> compressed_;
+#endif
+};
+
+namespace export_detail {
+
+template <class T>
+struct is_optional : std::false_type {};
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+// Column type byte of the columnar layout for a member type
+template <class Member>
+constexpr uint8_t column_type() {
+    if constexpr (std::is_same_v<Member, std::string>) return 3;
+    else if constexpr (std::is_same_v<Member, std::optional<std::string>>) return 4;
+    else if constexpr (std::is_floating_point_v<Member>) return 2;
+    else {
+        static_assert(std::is_integral_v<Member>, "columnar export has no encoding for this member type");
+        return 1;
+    }
+}
+
+inline void append_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void append_csv_field(std::string& out, std::string_view value) {
+    if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(value);
+        return;
+    }
+    out.push_back('"');
+    for (const char c : value) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+template <class Member>
+void append_csv_value(std::string& out, const Member& value) {
+    if constexpr (std::is_same_v<Member, std::string>) {
+        append_csv_field(out, value);
+    } else if constexpr (is_optional<Member>::value) {
+        if (value) append_csv_value(out, *value);
+    } else if constexpr (std::is_floating_point_v<Member>) {
+        append_json_number(out, static_cast<double>(value));
+    } else {
+        append_json_number(out, static_cast<long long>(value));
+    }
+}
+
+// One column of the block being built
+struct ColumnBuffer {
+    std::string nulls;   // Nullable text only
+    std::string head;    // Varints or fixed-width values
+    std::string bytes;   // Text payload
+};
+
+template <class Row>
+class ColumnarEncoder {
+public:
+    explicit ColumnarEncoder(ExportSpool& spool) : spool_(spool) {
+        std::string& out = spool_.buffer();
+        out.append("LMCOL1\n");
+        append_varint(out, std::tuple_size_v<std::decay_t<decltype(RowSchema<Row>::fields)>>);
+        for_each_row_field<Row>([&](const auto& field) {
+            using Member = std::decay_t<decltype(std::declval<const Row&>().*(field.member))>;
+            const std::string_view name = row_field_name(field);
+            append_varint(out, name.size());
+            out.append(name);
+            out.push_back(static_cast<char>(column_type<Member>()));
+            columns_.emplace_back();
+        });
+    }
+
+    void add(const Row& row) {
+        size_t col = 0;
+        const size_t bit = rows_ % 8;
+        for_each_row_field<Row>([&](const auto& field) {
+            ColumnBuffer& column = columns_[col++];
+            const auto& value = row.*(field.member);
+            using Member = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Member, std::string>) {
+                append_varint(column.head, value.size());
+                column.bytes.append(value);
+            } else if constexpr (std::is_same_v<Member, std::optional<std::string>>) {
+                if (bit == 0) column.nulls.push_back(0);
+                if (value) {
+                    append_varint(column.head, value->size());
+                    column.bytes.append(*value);
+                } else {
+                    column.nulls.back() = static_cast<char>(column.nulls.back() | (1 << bit));
+                }
+            } else if constexpr (std::is_floating_point_v<Member>) {
+                const double number = value;
+                uint64_t bits;
+                std::memcpy(&bits, &number, sizeof(bits));
+                for (int i = 0; i < 8; ++i) column.head.push_back(static_cast<char>(bits >> (8 * i)));
+            } else {
+                const auto number = static_cast<int64_t>(value);
+                append_varint(column.head, (static_cast<uint64_t>(number) << 1) ^ static_cast<uint64_t>(number >> 63));
+            }
+        });
+        if (++rows_ == columnar_block_rows) flush_block();
+    }
+
+    void finish() {
+        if (rows_ > 0) flush_block();
+        append_varint(spool_.buffer(), 0);
+    }
+
+private:
+    void flush_block() {
+        std::string& out = spool_.buffer();
+        append_varint(out, rows_);
+        for (auto& column : columns_) {
+            append_varint(out, column.nulls.size() + column.head.size() + column.bytes.size());
+            out.append(column.nulls);
+            out.append(column.head);
+            out.append(column.bytes);
+            column.nulls.clear();
+            column.head.clear();
+            column.bytes.clear();
+        }
+        rows_ = 0;
+        spool_.flush_if_full();
+    }
+
+    ExportSpool& spool_;
+    std::vector<ColumnBuffer> columns_;
+    size_t rows_ = 0;
+};
+
+}  // namespace export_detail
+
+// Encodes every row scan visits into spool; scan(sink) runs the repository scan and returns
+// its row count
+template <class Row>
+long long export_rows(ExportFormat format, ExportSpool& spool, const std::function<long long(const RowSink<Row>&)>& scan) {
+    using namespace export_detail;
+    std::string& out = spool.buffer();
+    long long rows = 0;
+
+    if (format == ExportFormat::ndjson) {
+        rows = scan([&](const Row& row) {
+            append_row_json(out, row);
+            out.push_back('\n');
+            spool.flush_if_full();
+        });
+    } else if (format == ExportFormat::csv) {
+        bool first = true;
+        for_each_row_field<Row>([&](const auto& field) {
+            if (!first) out.push_back(',');
+            first = false;
+            out.append(row_field_name(field));
+        });
+        out.append("\r\n");
+        rows = scan([&](const Row& row) {
+            bool first_value = true;
+            for_each_row_field<Row>([&](const auto& field) {
+                if (!first_value) out.push_back(',');
+                first_value = false;
+                append_csv_value(out, row.*(field.member));
+            });
+            out.append("\r\n");
+            spool.flush_if_full();
+        });
+    } else {
+        ColumnarEncoder<Row> encoder(spool);
+        rows = scan([&](const Row& row) { encoder.add(row); });
+        encoder.finish();
+    }
+    return rows;
+}
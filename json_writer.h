@@ -0,0 +1,64 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+// Minimal JSON output helpers that append straight into a response buffer,
+// for responses too large to go through a crow::json::wvalue tree.
+
+// Append s as a quoted JSON string. Input is assumed to be valid UTF-8 and is copied through
+// unchanged apart from the characters JSON requires to be escaped.
+inline void append_json_string(std::string& out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    size_t run_start = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        out.append(s.data() + run_start, i - run_start);
+        run_start = i + 1;
+        switch (c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            default:
+                out.append("\\u00");
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 0xF]);
+                break;
+        }
+    }
+    out.append(s.data() + run_start, s.size() - run_start);
+    out.push_back('"');
+}
+
+inline void append_json_number(std::string& out, long long value) {
+    char buf[24];
+    const auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+// Shortest round-trippable form; NaN and infinities become null, as crow::json does
+inline void append_json_number(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out.append("null");
+        return;
+    }
+    char buf[32];
+    const auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+// "key": prefix for object members; key must not need escaping
+inline void append_json_key(std::string& out, std::string_view key) {
+    out.push_back('"');
+    out.append(key.data(), key.size());
+    out.append("\":");
+}
@@ -48,8 +48,8 @@ void startBackend() {
 
 // 启动前端页面
 void startFrontend() {
-    // 使用默认浏览器打开前端页面
-    system("start index.html");
+    // 使用默认浏览器打开前端页面（由后端提供，与 API 同源）
+    system("start http://localhost:8080/");
     std::cout << "前端页面已启动。" << std::endl;
 }
 
@@ -0,0 +1,383 @@
+#pragma once
+
+#include "book_search.h"
+#include "models.h"
+#include "repository.h"
+#include "sql_database.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Storage engine that keeps every table in ordered maps in this process.
+//
+// Used on its own (LIBRARY_STORAGE=memory) it measures handler cost with no database behind
+// it. As the front half of CachedStorage it serves every read while the backing database
+// stays the system of record. Readers share a lock; writers take it exclusively. A
+// transaction holds the exclusive lock from begin() to commit() and keeps an undo log for
+// rollback(). Nothing is persisted.
+
+namespace memory_storage_detail {
+
+// ASCII case-insensitive comparisons, matching the default SQL Server and SQLite collations
+inline char fold(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+inline bool equals(const std::string& value, const std::string& keyword) {
+    if (value.size() != keyword.size()) return false;
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (fold(value[i]) != fold(keyword[i])) return false;
+    }
+    return true;
+}
+
+inline bool starts_with(const std::string& value, const std::string& keyword) {
+    return value.size() >= keyword.size() && equals(value.substr(0, keyword.size()), keyword);
+}
+
+inline bool contains(const std::string& value, const std::string& keyword) {
+    if (keyword.empty()) return true;
+    for (size_t i = 0; i + keyword.size() <= value.size(); ++i) {
+        size_t k = 0;
+        while (k < keyword.size() && fold(value[i + k]) == fold(keyword[k])) ++k;
+        if (k == keyword.size()) return true;
+    }
+    return false;
+}
+
+}  // namespace memory_storage_detail
+
+class MemoryStorage : public Storage {
+public:
+    using RecordKey = std::pair<std::string, std::string>;  // (book_id, reader_id)
+
+    struct Tables {
+        std::map<std::string, Book> books;
+        std::map<std::string, Reader> readers;
+        std::map<RecordKey, Record> records;
+    };
+
+    const char* name() const override { return "memory"; }
+
+    std::unique_ptr<StorageSession> session() override { return std::make_unique<Session>(*this); }
+
+    // Runs change under the exclusive lock, so readers see all of it or none of it
+    void apply(const std::function<void(Tables&)>& change) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        change(tables_);
+    }
+
+private:
+    using UndoLog = std::vector<std::function<void(Tables&)>>;
+
+    class Session;
+
+    // Reads take the shared lock and writes the exclusive one, unless the session already
+    // holds the exclusive lock for a transaction
+    class Access {
+    public:
+        explicit Access(Session& session) : session_(session) {}
+
+    protected:
+        template <class F>
+        auto read(F&& f) {
+            if (session_.transaction_lock_) return f(session_.storage_.tables_);
+            std::shared_lock<std::shared_mutex> lock(session_.storage_.mutex_);
+            return f(session_.storage_.tables_);
+        }
+
+        template <class F>
+        auto write(F&& f) {
+            if (session_.transaction_lock_) return f(session_.storage_.tables_, &session_.undo_);
+            std::unique_lock<std::shared_mutex> lock(session_.storage_.mutex_);
+            return f(session_.storage_.tables_, static_cast<UndoLog*>(nullptr));
+        }
+
+        // Undo for a write to table[key]: restore the previous row, or erase the key
+        template <class Map>
+        static void remember(UndoLog* undo, Map Tables::*table, const typename Map::key_type& key, const Map& map) {
+            if (!undo) return;
+            auto found = map.find(key);
+            if (found == map.end()) {
+                undo->push_back([table, key](Tables& tables) { (tables.*table).erase(key); });
+            } else {
+                undo->push_back([table, key, row = found->second](Tables& tables) { (tables.*table)[key] = row; });
+            }
+        }
+
+    private:
+        Session& session_;
+    };
+
+    class Books : public BookRepository, Access {
+    public:
+        using Access::Access;
+
+        long long scan(const BookScan& scan, const RowSink<Book>& sink) override {
+            return read([&](Tables& tables) {
+                auto it = tables.books.begin();
+                if (scan.limit > 0 && scan.offset == 0 && !scan.after.empty()) {
+                    it = tables.books.upper_bound(scan.after);
+                }
+                for (long long skipped = 0; skipped < scan.offset && it != tables.books.end(); ++skipped) ++it;
+
+                long long count = 0;
+                for (; it != tables.books.end() && (scan.limit <= 0 || count < scan.limit); ++it, ++count) {
+                    sink(it->second);
+                }
+                return count;
+            });
+        }
+
+        long long count() override {
+            return read([](Tables& tables) { return static_cast<long long>(tables.books.size()); });
+        }
+
+        std::optional<Book> find(const std::string& book_id) override {
+            return read([&](Tables& tables) -> std::optional<Book> {
+                auto found = tables.books.find(book_id);
+                if (found == tables.books.end()) return std::nullopt;
+                return found->second;
+            });
+        }
+
+        // Same predicates as plan_book_search, evaluated against every row
+        long long search(const BookSearchRequest& request, const RowSink<Book>& sink, std::vector<std::string>& plan) override {
+            using namespace memory_storage_detail;
+            std::string keyword = request.keyword;
+            std::string match = request.match;
+            if (!keyword.empty() && keyword.back() == '*') {
+                keyword.pop_back();
+                match = "prefix";
+            }
+            const std::string isbn = (request.search_by == "isbn" || request.search_by == "all") ? normalize_isbn(keyword) : std::string();
+            const auto matches = [&](const std::string& value) {
+                if (match == "exact") return equals(value, keyword);
+                if (match == "prefix") return starts_with(value, keyword);
+                return contains(value, keyword);
+            };
+
+            plan.push_back("memory_scan");
+            return read([&](Tables& tables) {
+                long long count = 0;
+                for (const auto& [id, book] : tables.books) {
+                    if (request.min_price && book.book_price < *request.min_price) continue;
+                    if (request.max_price && book.book_price > *request.max_price) continue;
+                    if (!keyword.empty()) {
+                        bool hit;
+                        if (!isbn.empty()) {
+                            hit = strip_isbn(book.book_isbn) == isbn ||
+                                  (request.search_by == "all" &&
+                                   (matches(book.book_name) || matches(book.book_author) || matches(book.book_publisher)));
+                        } else if (request.search_by == "title") {
+                            hit = matches(book.book_name);
+                        } else if (request.search_by == "author") {
+                            hit = matches(book.book_author);
+                        } else if (request.search_by == "publisher") {
+                            hit = matches(book.book_publisher);
+                        } else if (request.search_by == "isbn") {
+                            hit = matches(book.book_isbn);
+                        } else {
+                            hit = matches(book.book_name) || matches(book.book_author) ||
+                                  matches(book.book_isbn) || matches(book.book_publisher);
+                        }
+                        if (!hit) continue;
+                    }
+                    sink(book);
+                    ++count;
+                }
+                return count;
+            });
+        }
+
+        void insert(const Book& book) override {
+            write([&](Tables& tables, UndoLog* undo) {
+                if (tables.books.count(book.book_id)) throw SqlError("Duplicate book_id " + book.book_id, true);
+                remember(undo, &Tables::books, book.book_id, tables.books);
+                tables.books.emplace(book.book_id, book);
+            });
+        }
+
+        // One exclusive lock for the whole call; batch_size has nothing to amortize here
+        BulkInsertResult insert_many(const std::vector<Book>& books, size_t /*batch_size*/) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                BulkInsertResult result;
+                for (size_t i = 0; i < books.size(); ++i) {
+                    const Book& book = books[i];
+                    if (tables.books.count(book.book_id)) {
+                        result.duplicates.push_back(i);
+                        continue;
+                    }
+                    remember(undo, &Tables::books, book.book_id, tables.books);
+                    tables.books.emplace(book.book_id, book);
+                    ++result.inserted;
+                }
+                return result;
+            });
+        }
+
+        bool update(const Book& book) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                auto found = tables.books.find(book.book_id);
+                if (found == tables.books.end()) return false;
+                remember(undo, &Tables::books, book.book_id, tables.books);
+                found->second = book;
+                return true;
+            });
+        }
+
+        bool remove(const std::string& book_id) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                if (!tables.books.count(book_id)) return false;
+                remember(undo, &Tables::books, book_id, tables.books);
+                tables.books.erase(book_id);
+                return true;
+            });
+        }
+    };
+
+    class Readers : public ReaderRepository, Access {
+    public:
+        using Access::Access;
+
+        long long scan(const RowSink<Reader>& sink) override {
+            return read([&](Tables& tables) {
+                for (const auto& entry : tables.readers) sink(entry.second);
+                return static_cast<long long>(tables.readers.size());
+            });
+        }
+
+        std::optional<Reader> find(const std::string& reader_id) override {
+            return read([&](Tables& tables) -> std::optional<Reader> {
+                auto found = tables.readers.find(reader_id);
+                if (found == tables.readers.end()) return std::nullopt;
+                return found->second;
+            });
+        }
+
+        void insert(const Reader& reader) override {
+            write([&](Tables& tables, UndoLog* undo) {
+                if (tables.readers.count(reader.reader_id)) throw SqlError("Duplicate reader_id " + reader.reader_id, true);
+                remember(undo, &Tables::readers, reader.reader_id, tables.readers);
+                tables.readers.emplace(reader.reader_id, reader);
+            });
+        }
+
+        bool update(const Reader& reader) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                auto found = tables.readers.find(reader.reader_id);
+                if (found == tables.readers.end()) return false;
+                remember(undo, &Tables::readers, reader.reader_id, tables.readers);
+                found->second = reader;
+                return true;
+            });
+        }
+
+        bool remove(const std::string& reader_id) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                if (!tables.readers.count(reader_id)) return false;
+                remember(undo, &Tables::readers, reader_id, tables.readers);
+                tables.readers.erase(reader_id);
+                return true;
+            });
+        }
+    };
+
+    class Records : public RecordRepository, Access {
+    public:
+        using Access::Access;
+
+        long long scan(const RowSink<Record>& sink) override {
+            return read([&](Tables& tables) {
+                for (const auto& entry : tables.records) sink(entry.second);
+                return static_cast<long long>(tables.records.size());
+            });
+        }
+
+        std::optional<Record> find(const std::string& book_id, const std::string& reader_id) override {
+            return read([&](Tables& tables) -> std::optional<Record> {
+                auto found = tables.records.find(RecordKey(book_id, reader_id));
+                if (found == tables.records.end()) return std::nullopt;
+                return found->second;
+            });
+        }
+
+        void insert(const Record& record) override {
+            write([&](Tables& tables, UndoLog* undo) {
+                const RecordKey key(record.book_id, record.reader_id);
+                if (tables.records.count(key)) {
+                    throw SqlError("Duplicate record for book " + record.book_id + " and reader " + record.reader_id, true);
+                }
+                remember(undo, &Tables::records, key, tables.records);
+                tables.records.emplace(key, record);
+            });
+        }
+
+        bool update(const Record& record) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                const RecordKey key(record.book_id, record.reader_id);
+                auto found = tables.records.find(key);
+                if (found == tables.records.end()) return false;
+                remember(undo, &Tables::records, key, tables.records);
+                found->second = record;
+                return true;
+            });
+        }
+
+        bool remove(const std::string& book_id, const std::string& reader_id) override {
+            return write([&](Tables& tables, UndoLog* undo) {
+                const RecordKey key(book_id, reader_id);
+                if (!tables.records.count(key)) return false;
+                remember(undo, &Tables::records, key, tables.records);
+                tables.records.erase(key);
+                return true;
+            });
+        }
+    };
+
+    class Session : public StorageSession {
+    public:
+        explicit Session(MemoryStorage& storage) : storage_(storage), books_(*this), readers_(*this), records_(*this) {}
+
+        ~Session() override { rollback(); }
+
+        BookRepository& books() override { return books_; }
+        ReaderRepository& readers() override { return readers_; }
+        RecordRepository& records() override { return records_; }
+
+        void begin() override {
+            if (transaction_lock_) return;
+            transaction_lock_ = std::unique_lock<std::shared_mutex>(storage_.mutex_);
+            undo_.clear();
+        }
+
+        void commit() override {
+            undo_.clear();
+            transaction_lock_.reset();
+        }
+
+        void rollback() override {
+            if (!transaction_lock_) return;
+            for (auto it = undo_.rbegin(); it != undo_.rend(); ++it) (*it)(storage_.tables_);
+            undo_.clear();
+            transaction_lock_.reset();
+        }
+
+    private:
+        friend class Access;
+
+        MemoryStorage& storage_;
+        std::optional<std::unique_lock<std::shared_mutex>> transaction_lock_;
+        UndoLog undo_;
+        Books books_;
+        Readers readers_;
+        Records records_;
+    };
+
+    mutable std::shared_mutex mutex_;
+    Tables tables_;
+};
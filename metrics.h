@@ -0,0 +1,385 @@
+#pragma once
+
+#include "request_trace.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Per-route request metrics, exposed in the Prometheus text format by GET /metrics.
+//
+// Every thread records into its own shard: a set of counters only that thread writes, so a
+// recording is a few plain loads and stores with no lock or contended cache line. A scrape
+// sums the shards. Shards are created on a thread's first request. Per-series storage inside
+// a shard is allocated the first time that thread serves that route and method.
+//
+// Latencies go into HDR-style log-linear histograms over whole microseconds. Below 8 us every
+// value has its own bucket. Above that, each power of two is split into 8 buckets, so a bucket
+// is at most 12.5% wide, up to 2^36 us (about 19 hours). The exposition reduces them to
+// power-of-two `le` bounds for Prometheus and reports p50/p90/p99/p999 from the full resolution.
+//
+// Each request's phase breakdown (request_trace.h) is recorded the same way, one histogram
+// per phase.
+
+namespace metrics_detail {
+
+constexpr unsigned sub_bucket_bits = 3;
+constexpr uint64_t sub_buckets = 1u << sub_bucket_bits;
+constexpr unsigned max_magnitude = 36;
+constexpr size_t bucket_count = (max_magnitude - sub_bucket_bits + 2) * sub_buckets;
+
+inline unsigned highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+inline size_t bucket_index(uint64_t us) {
+    if (us < sub_buckets) return static_cast<size_t>(us);
+    const unsigned magnitude = highest_bit(us);
+    if (magnitude > max_magnitude) return bucket_count - 1;
+    const unsigned shift = magnitude - sub_bucket_bits;
+    return static_cast<size_t>((shift + 1) * sub_buckets + ((us >> shift) & (sub_buckets - 1)));
+}
+
+// Smallest value (us) that lands in bucket i
+inline uint64_t bucket_lower(size_t i) {
+    if (i < sub_buckets) return i;
+    const uint64_t shift = i / sub_buckets - 1;
+    return (sub_buckets + i % sub_buckets) << shift;
+}
+
+// Counter with a single writing thread; readers on other threads see whole values
+struct OwnedCounter {
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+struct Histogram {
+    std::array<OwnedCounter, bucket_count> buckets;
+    OwnedCounter sum_us;
+
+    void record(uint64_t us) {
+        buckets[bucket_index(us)].add(1);
+        sum_us.add(us);
+    }
+};
+
+// Response status counts; codes claim slots in arrival order and the last slot takes the overflow
+constexpr size_t status_slots = 16;
+
+struct SeriesShard {
+    Histogram latency;
+    std::array<Histogram, request_phase_count> phases;
+    std::atomic<int64_t> in_flight{0};
+    OwnedCounter response_bytes;
+    std::array<std::atomic<int>, status_slots> status_codes{};
+    std::array<OwnedCounter, status_slots> status_counts;
+
+    void count_status(int code) {
+        for (size_t i = 0; i < status_slots - 1; ++i) {
+            const int slot = status_codes[i].load(std::memory_order_relaxed);
+            if (slot == code) {
+                status_counts[i].add(1);
+                return;
+            }
+            if (slot == 0) {
+                status_codes[i].store(code, std::memory_order_release);
+                status_counts[i].add(1);
+                return;
+            }
+        }
+        status_codes[status_slots - 1].store(-1, std::memory_order_relaxed);
+        status_counts[status_slots - 1].add(1);
+    }
+};
+
+// Everything one thread records. series[i] is published once by the owning thread.
+struct ThreadShard {
+    explicit ThreadShard(size_t series_count) : series(series_count) {}
+
+    std::vector<std::atomic<SeriesShard*>> series;
+    std::vector<std::unique_ptr<SeriesShard>> owned;
+};
+
+// Totals of one histogram over all shards
+struct HistogramTotals {
+    std::array<uint64_t, bucket_count> buckets{};
+    uint64_t count = 0;
+    uint64_t sum_us = 0;
+
+    void add(const Histogram& histogram) {
+        for (size_t i = 0; i < bucket_count; ++i) {
+            const uint64_t n = histogram.buckets[i].get();
+            buckets[i] += n;
+            count += n;
+        }
+        sum_us += histogram.sum_us.get();
+    }
+
+    // Middle of the bucket holding the q-quantile, in microseconds
+    double quantile(double q) const {
+        if (count == 0) return 0.0;
+        const double rank = q * static_cast<double>(count);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            seen += buckets[i];
+            if (static_cast<double>(seen) >= rank && buckets[i] > 0) {
+                const uint64_t upper = i + 1 < bucket_count ? bucket_lower(i + 1) : bucket_lower(i) * 2;
+                return static_cast<double>(bucket_lower(i) + upper - 1) / 2.0;
+            }
+        }
+        return static_cast<double>(bucket_lower(bucket_count - 1));
+    }
+};
+
+}  // namespace metrics_detail
+
+// Sample values and le bounds, shortest form that round-trips closely enough for a scrape
+inline void append_metric_number(std::string& out, double value) {
+    char buffer[32];
+    const int n = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out.append(buffer, static_cast<size_t>(n));
+}
+
+// Writes "# HELP" and "# TYPE" for a metric family
+inline void append_metric_header(std::string& out, const char* name, const char* type, const char* help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+// One sample line; labels is the inside of the braces, already escaped
+inline void append_metric(std::string& out, std::string_view name, std::string_view labels, double value) {
+    out.append(name);
+    if (!labels.empty()) out.append("{").append(labels).append("}");
+    out.push_back(' ');
+    append_metric_number(out, value);
+    out.push_back('\n');
+}
+
+class RequestMetrics {
+public:
+    // routes are path templates in match order; a "<...>" segment matches any one segment.
+    // Paths matching none are counted under "other", as are methods missing from methods.
+    RequestMetrics(std::vector<std::string> routes, std::vector<std::string> methods)
+        : routes_(std::move(routes)), methods_(std::move(methods)) {
+        routes_.push_back("other");
+        methods_.push_back("other");
+        for (size_t i = 0; i + 1 < routes_.size(); ++i) patterns_.push_back(split(routes_[i]));
+    }
+
+    RequestMetrics(const RequestMetrics&) = delete;
+    RequestMetrics& operator=(const RequestMetrics&) = delete;
+
+    // Series for a request path and method name
+    size_t series(std::string_view path, std::string_view method) const {
+        size_t route = routes_.size() - 1;
+        for (size_t i = 0; i < patterns_.size(); ++i) {
+            if (matches(patterns_[i], path)) {
+                route = i;
+                break;
+            }
+        }
+        size_t method_index = methods_.size() - 1;
+        for (size_t i = 0; i + 1 < methods_.size(); ++i) {
+            if (methods_[i] == method) {
+                method_index = i;
+                break;
+            }
+        }
+        return route * methods_.size() + method_index;
+    }
+
+    void begin(size_t series) { shard(series).in_flight.fetch_add(1, std::memory_order_relaxed); }
+
+    // Records a finished request. phase_ns is what PhaseClock::stop() returned for it.
+    void end(size_t series, std::chrono::steady_clock::duration elapsed, int status, uint64_t bytes,
+             const std::array<uint64_t, request_phase_count>& phase_ns) {
+        metrics_detail::SeriesShard& s = shard(series);
+        s.in_flight.fetch_sub(1, std::memory_order_relaxed);
+        s.latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        for (size_t i = 0; i < request_phase_count; ++i) {
+            if (phase_ns[i] > 0) s.phases[i].record(phase_ns[i] / 1000);
+        }
+        s.response_bytes.add(bytes);
+        s.count_status(status);
+    }
+
+    // Appends every series that has seen a request
+    void append_prometheus(std::string& out) const {
+        using namespace metrics_detail;
+        const size_t series_count = routes_.size() * methods_.size();
+        std::vector<HistogramTotals> latency(series_count);
+        std::vector<std::array<HistogramTotals, request_phase_count>> phases(series_count);
+        std::vector<int64_t> in_flight(series_count, 0);
+        std::vector<uint64_t> bytes(series_count, 0);
+        std::vector<std::vector<std::pair<int, uint64_t>>> statuses(series_count);
+        std::vector<bool> seen(series_count, false);
+
+        {
+            std::lock_guard<std::mutex> lock(shards_mutex_);
+            for (const auto& thread : shards_) {
+                for (size_t i = 0; i < series_count; ++i) {
+                    const SeriesShard* s = thread->series[i].load(std::memory_order_acquire);
+                    if (!s) continue;
+                    seen[i] = true;
+                    latency[i].add(s->latency);
+                    for (size_t p = 0; p < request_phase_count; ++p) phases[i][p].add(s->phases[p]);
+                    in_flight[i] += s->in_flight.load(std::memory_order_relaxed);
+                    bytes[i] += s->response_bytes.get();
+                    for (size_t slot = 0; slot < status_slots; ++slot) {
+                        const int code = s->status_codes[slot].load(std::memory_order_acquire);
+                        if (code == 0) continue;
+                        const uint64_t count = s->status_counts[slot].get();
+                        auto& list = statuses[i];
+                        auto found = std::find_if(list.begin(), list.end(), [&](const auto& entry) { return entry.first == code; });
+                        if (found == list.end()) list.emplace_back(code, count);
+                        else found->second += count;
+                    }
+                }
+            }
+        }
+
+        const auto labels = [&](size_t i) {
+            return "route=\"" + routes_[i / methods_.size()] + "\",method=\"" + methods_[i % methods_.size()] + "\"";
+        };
+
+        append_metric_header(out, "library_http_requests_in_flight", "gauge", "Requests being handled");
+        for (size_t i = 0; i < series_count; ++i) {
+            if (seen[i]) append_metric(out, "library_http_requests_in_flight", labels(i), static_cast<double>(in_flight[i]));
+        }
+
+        append_metric_header(out, "library_http_request_duration_seconds", "histogram", "Time from routing to the response being ready");
+        for (size_t i = 0; i < series_count; ++i) {
+            if (seen[i]) append_histogram(out, "library_http_request_duration_seconds", labels(i), latency[i]);
+        }
+
+        append_metric_header(out, "library_http_request_latency_seconds", "summary",
+                             "Request duration quantiles since start, from the full-resolution histogram");
+        for (size_t i = 0; i < series_count; ++i) {
+            if (!seen[i]) continue;
+            for (const double q : {0.5, 0.9, 0.99, 0.999}) {
+                std::string quantile_labels = labels(i) + ",quantile=\"";
+                append_metric_number(quantile_labels, q);
+                quantile_labels += "\"";
+                append_metric(out, "library_http_request_latency_seconds", quantile_labels, latency[i].quantile(q) / 1e6);
+            }
+            append_metric(out, "library_http_request_latency_seconds_sum", labels(i), static_cast<double>(latency[i].sum_us) / 1e6);
+            append_metric(out, "library_http_request_latency_seconds_count", labels(i), static_cast<double>(latency[i].count));
+        }
+
+        append_metric_header(out, "library_http_phase_duration_seconds", "histogram",
+                             "Time a request spent in each phase (see request_trace.h)");
+        for (size_t i = 0; i < series_count; ++i) {
+            if (!seen[i]) continue;
+            for (size_t p = 0; p < request_phase_count; ++p) {
+                if (phases[i][p].count == 0) continue;
+                append_histogram(out, "library_http_phase_duration_seconds", labels(i) + ",phase=\"" + request_phase_names[p] + "\"",
+                                 phases[i][p]);
+            }
+        }
+
+        append_metric_header(out, "library_http_response_bytes_total", "counter", "Response body bytes");
+        for (size_t i = 0; i < series_count; ++i) {
+            if (seen[i]) append_metric(out, "library_http_response_bytes_total", labels(i), static_cast<double>(bytes[i]));
+        }
+
+        append_metric_header(out, "library_http_responses_total", "counter", "Responses by status code");
+        for (size_t i = 0; i < series_count; ++i) {
+            for (const auto& [code, count] : statuses[i]) {
+                const std::string status = code < 0 ? "other" : std::to_string(code);
+                append_metric(out, "library_http_responses_total", labels(i) + ",status=\"" + status + "\"", static_cast<double>(count));
+            }
+        }
+    }
+
+private:
+    static std::vector<std::string> split(std::string_view path) {
+        std::vector<std::string> segments;
+        size_t pos = 0;
+        while (pos <= path.size()) {
+            size_t end = path.find('/', pos);
+            if (end == std::string_view::npos) end = path.size();
+            segments.emplace_back(path.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        return segments;
+    }
+
+    static bool matches(const std::vector<std::string>& pattern, std::string_view path) {
+        size_t pos = 0;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (pos > path.size()) return false;
+            size_t end = path.find('/', pos);
+            if (end == std::string_view::npos) end = path.size();
+            const std::string_view segment = path.substr(pos, end - pos);
+            const bool wildcard = !pattern[i].empty() && pattern[i].front() == '<';
+            if (wildcard ? segment.empty() : segment != pattern[i]) return false;
+            pos = end + 1;
+        }
+        return pos == path.size() + 1;
+    }
+
+    // Cumulative counts at power-of-two microsecond bounds from 64 us to about 33 s. Those are
+    // bucket edges, so every count is exact; le is read as "below", which whole microseconds
+    // make the same thing.
+    static void append_histogram(std::string& out, const char* name, const std::string& labels,
+                                 const metrics_detail::HistogramTotals& totals) {
+        using namespace metrics_detail;
+        const std::string bucket_name = std::string(name) + "_bucket";
+        uint64_t cumulative = 0;
+        size_t next = 0;
+        for (unsigned power = 6; power <= 25; ++power) {
+            const size_t edge = bucket_index(uint64_t{1} << power);
+            for (; next < edge; ++next) cumulative += totals.buckets[next];
+            std::string le = labels + ",le=\"";
+            append_metric_number(le, static_cast<double>(uint64_t{1} << power) / 1e6);
+            le += "\"";
+            append_metric(out, bucket_name, le, static_cast<double>(cumulative));
+        }
+        append_metric(out, bucket_name, labels + ",le=\"+Inf\"", static_cast<double>(totals.count));
+        append_metric(out, std::string(name) + "_sum", labels, static_cast<double>(totals.sum_us) / 1e6);
+        append_metric(out, std::string(name) + "_count", labels, static_cast<double>(totals.count));
+    }
+
+    metrics_detail::SeriesShard& shard(size_t series) {
+        struct Cached {
+            const RequestMetrics* owner = nullptr;
+            metrics_detail::ThreadShard* shard = nullptr;
+        };
+        thread_local Cached cached;
+        if (cached.owner != this) {
+            auto created = std::make_unique<metrics_detail::ThreadShard>(routes_.size() * methods_.size());
+            cached = {this, created.get()};
+            std::lock_guard<std::mutex> lock(shards_mutex_);
+            shards_.push_back(std::move(created));
+        }
+        metrics_detail::ThreadShard& thread = *cached.shard;
+        metrics_detail::SeriesShard* s = thread.series[series].load(std::memory_order_relaxed);
+        if (!s) {
+            thread.owned.push_back(std::make_unique<metrics_detail::SeriesShard>());
+            s = thread.owned.back().get();
+            thread.series[series].store(s, std::memory_order_release);
+        }
+        return *s;
+    }
+
+    std::vector<std::string> routes_;
+    std::vector<std::string> methods_;
+    std::vector<std::vector<std::string>> patterns_;
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<metrics_detail::ThreadShard>> shards_;
+};
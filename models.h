@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+// Row types shared by the handlers, the search index and the caches. Text is UTF-8.
+
+struct Book {
+    std::string book_id;
+    std::string book_name;
+    std::string book_isbn;
+    std::string book_author;
+    std::string book_publisher;
+    int interview_times = 0;
+    double book_price = 0.0;
+};
+
+struct Reader {
+    std::string reader_id;
+    std::string reader_name;
+    std::string reader_sex;
+    std::string reader_department;
+};
+
+// Dates are ISO 8601 (YYYY-MM-DD); return_date is unset until the book comes back
+struct Record {
+    std::string reader_id;
+    std::string book_id;
+    std::string borrow_date;
+    std::optional<std::string> return_date;
+    std::optional<std::string> notes;
+};
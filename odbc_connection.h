@@ -0,0 +1,66 @@
+#pragma once
+
+#include "sql_database.h"
+#include <nanodbc/nanodbc.h>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+// A pooled ODBC connection together with the statements prepared on it.
+// Statements are keyed by SQL text and live as long as the session does, so a
+// reconnect (which creates a new OdbcConnection) starts with an empty cache.
+// Only use prepared() for statements that do not leave a cursor open (INSERT/UPDATE/DELETE);
+// callers rebind every parameter before each execute.
+class OdbcConnection {
+public:
+    static constexpr size_t default_cache_capacity = 32;
+
+    explicit OdbcConnection(const nanodbc::string& connection_string, size_t cache_capacity = default_cache_capacity)
+        : connection_(connection_string), capacity_(cache_capacity ? cache_capacity : 1) {}
+
+    OdbcConnection(const OdbcConnection&) = delete;
+    OdbcConnection& operator=(const OdbcConnection&) = delete;
+
+    nanodbc::connection& native() { return connection_; }
+    bool connected() const { return connection_.connected(); }
+
+    // Returns a statement prepared for sql, preparing it on first use.
+    // Parameters from the previous execute are reset so stale bindings never leak into the next call.
+    nanodbc::statement& prepared(const nanodbc::string& sql) {
+        auto found = index_.find(sql);
+        if (found != index_.end()) {
+            StatementCacheStats::hits.fetch_add(1, std::memory_order_relaxed);
+            entries_.splice(entries_.begin(), entries_, found->second);
+            nanodbc::statement& stmt = *found->second->second;
+            stmt.reset_parameters();
+            return stmt;
+        }
+
+        StatementCacheStats::misses.fetch_add(1, std::memory_order_relaxed);
+        auto stmt = std::make_unique<nanodbc::statement>(connection_);
+        nanodbc::prepare(*stmt, sql);
+
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+            StatementCacheStats::evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        entries_.emplace_front(sql, std::move(stmt));
+        index_.emplace(sql, entries_.begin());
+        return *entries_.front().second;
+    }
+
+    size_t cached_statements() const { return entries_.size(); }
+
+private:
+    using Entry = std::pair<nanodbc::string, std::unique_ptr<nanodbc::statement>>;
+
+    // Declared first so cached statements are destroyed before the connection they belong to
+    nanodbc::connection connection_;
+    size_t capacity_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<nanodbc::string, std::list<Entry>::iterator> index_;
+};
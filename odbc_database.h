@@ -0,0 +1,299 @@
+#pragma once
+
+#include "connection_pool.h"
+#include "odbc_connection.h"
+#include "request_trace.h"
+#include "sql_database.h"
+#include "utf8.h"
+#include <nanodbc/nanodbc.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <sql.h>
+#include <sqlext.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// SQL Server (or any ODBC data source) behind the SqlDatabase interface.
+
+// UTF-8 text from the handlers to the driver's wide string type
+inline nanodbc::string utf8_to_wstring(const std::string& str) {
+    nanodbc::string wide;
+    append_utf16(wide, str);
+    return wide;
+}
+
+// Driver wide string to UTF-8; hot loops should use append_utf8 into a reused buffer instead
+inline std::string wstring_to_utf8(const nanodbc::string& wstr) {
+    std::string utf8;
+    append_utf8(utf8, wstr);
+    return utf8;
+}
+
+struct OdbcOptions {
+    nanodbc::string connection_string;
+    // Fetch text columns as SQL_C_CHAR and use the bytes as-is. Only valid when the driver hands
+    // back UTF-8: a UTF-8 client locale on Linux, or a UTF-8 collation / the UTF-8 ANSI code page
+    // on Windows. Otherwise columns come back as UTF-16 and are transcoded.
+    bool narrow_text_fetch = false;
+};
+
+class OdbcRow : public SqlRow {
+public:
+    OdbcRow(nanodbc::result& result, bool narrow_text_fetch) : result_(result), narrow_(narrow_text_fetch) {}
+
+    bool is_null(short col) override { return result_.is_null(col); }
+
+    void text(short col, std::string& out) override {
+        if (narrow_) {
+            result_.get_ref<std::string>(col, std::string(), out);
+            return;
+        }
+        result_.get_ref<nanodbc::string>(col, nanodbc::string(), wide_);
+        PhaseTimer timer(RequestPhase::transcode);
+        out.clear();
+        append_utf8(out, wide_);
+    }
+
+    long long integer(short col) override { return result_.get<long long>(col, 0); }
+    double real(short col) override { return result_.get<double>(col, 0.0); }
+
+private:
+    nanodbc::result& result_;
+    bool narrow_;
+    nanodbc::string wide_;  // Reused across columns and rows
+};
+
+class OdbcSession : public SqlSession {
+public:
+    OdbcSession(ConnectionLease<OdbcConnection> conn, bool narrow_text_fetch)
+        : conn_(std::move(conn)), narrow_(narrow_text_fetch) {}
+
+    // Open transactions are rolled back by nanodbc::transaction's destructor
+    ~OdbcSession() override { transaction_.reset(); }
+
+    long long query(const std::string& sql, const std::vector<SqlValue>& params, const SqlRowHandler& on_row) override {
+        PhaseTimer timer(RequestPhase::execute);
+        trace_statement(sql, params);
+        try {
+            // Not taken from the statement cache: a cached statement would keep its cursor open
+            nanodbc::statement stmt(conn_->native());
+            nanodbc::prepare(stmt, utf8_to_wstring(sql));
+            Bindings bindings;
+            bind(stmt, params, bindings);
+
+            auto result = nanodbc::execute(stmt);
+            timer.change(RequestPhase::fetch);
+            OdbcRow row(result, narrow_);
+            long long count = 0;
+            while (result.next()) {
+                on_row(row);
+                ++count;
+            }
+            return count;
+        } catch (const nanodbc::database_error& e) {
+            throw translate(e);
+        }
+    }
+
+    long long execute(const std::string& sql, const std::vector<SqlValue>& params) override {
+        PhaseTimer timer(RequestPhase::execute);
+        trace_statement(sql, params);
+        try {
+            nanodbc::statement& stmt = conn_->prepared(utf8_to_wstring(sql));
+            Bindings bindings;
+            bind(stmt, params, bindings);
+            auto result = nanodbc::execute(stmt);
+            return result.affected_rows();
+        } catch (const nanodbc::database_error& e) {
+            throw translate(e);
+        }
+    }
+
+    // Parameters are bound column-wise as arrays, so the whole batch is one SQLExecute. The
+    // rows written are counted from the per-parameter-set status array: SQLRowCount covers only
+    // the first set, and a failed set does not necessarily fail the execute.
+    long long execute_batch(const std::string& sql, const std::vector<std::vector<SqlValue>>& rows) override {
+        PhaseTimer timer(RequestPhase::execute);
+        if (rows.empty()) return 0;
+        trace_statement(sql, rows.front(), rows.size());
+        try {
+            nanodbc::statement& stmt = conn_->prepared(utf8_to_wstring(sql));
+            BatchBindings bindings;
+            bind_batch(stmt, rows, bindings);
+            std::vector<SQLUSMALLINT> status(rows.size(), SQL_PARAM_UNUSED);
+            const SQLHSTMT handle = static_cast<SQLHSTMT>(stmt.native_statement_handle());
+            if (!SQL_SUCCEEDED(SQLSetStmtAttr(handle, SQL_ATTR_PARAM_STATUS_PTR, status.data(), 0))) {
+                throw SqlError("Cannot set the parameter status array");
+            }
+            // The statement stays cached after this call; it must not keep pointing at status
+            struct ClearStatus {
+                SQLHSTMT handle;
+                ~ClearStatus() { SQLSetStmtAttr(handle, SQL_ATTR_PARAM_STATUS_PTR, nullptr, 0); }
+            } clear_status{handle};
+            nanodbc::just_execute(stmt, static_cast<long>(rows.size()));
+            long long written = 0;
+            for (const SQLUSMALLINT s : status) {
+                if (s == SQL_PARAM_SUCCESS || s == SQL_PARAM_SUCCESS_WITH_INFO) ++written;
+            }
+            return written;
+        } catch (const nanodbc::database_error& e) {
+            throw translate(e);
+        }
+    }
+
+    void begin() override {
+        PhaseTimer timer(RequestPhase::execute);
+        try {
+            transaction_ = std::make_unique<nanodbc::transaction>(conn_->native());
+        } catch (const nanodbc::database_error& e) {
+            throw translate(e);
+        }
+    }
+
+    void commit() override {
+        PhaseTimer timer(RequestPhase::execute);
+        if (!transaction_) return;
+        try {
+            transaction_->commit();
+            transaction_.reset();
+        } catch (const nanodbc::database_error& e) {
+            transaction_.reset();
+            throw translate(e);
+        }
+    }
+
+    void rollback() override {
+        PhaseTimer timer(RequestPhase::execute);
+        if (!transaction_) return;
+        transaction_->rollback();
+        transaction_.reset();
+    }
+
+private:
+    // Bound values must stay alive until execute
+    struct Bindings {
+        std::vector<nanodbc::string> text;
+        std::vector<long long> integers;
+        std::vector<double> reals;
+    };
+
+    static void bind(nanodbc::statement& stmt, const std::vector<SqlValue>& params, Bindings& bindings) {
+        bindings.text.reserve(params.size());
+        bindings.integers.reserve(params.size());
+        bindings.reals.reserve(params.size());
+        for (size_t i = 0; i < params.size(); ++i) {
+            const short index = static_cast<short>(i);
+            if (const auto* text = std::get_if<std::string>(&params[i])) {
+                bindings.text.push_back(utf8_to_wstring(*text));
+                stmt.bind(index, bindings.text.back().c_str());
+            } else if (const auto* integer = std::get_if<long long>(&params[i])) {
+                bindings.integers.push_back(*integer);
+                stmt.bind(index, &bindings.integers.back());
+            } else if (const auto* real = std::get_if<double>(&params[i])) {
+                bindings.reals.push_back(*real);
+                stmt.bind(index, &bindings.reals.back());
+            } else {
+                stmt.bind_null(index);
+            }
+        }
+    }
+
+    // One array per parameter column, alive until execute
+    struct BatchBindings {
+        std::vector<std::vector<nanodbc::string>> text;
+        std::vector<std::vector<long long>> integers;
+        std::vector<std::vector<double>> reals;
+        std::vector<std::unique_ptr<bool[]>> nulls;
+    };
+
+    // The column's type is taken from its first non-NULL value
+    static void bind_batch(nanodbc::statement& stmt, const std::vector<std::vector<SqlValue>>& rows, BatchBindings& bindings) {
+        const size_t batch = rows.size();
+        const size_t columns = rows.front().size();
+        for (size_t col = 0; col < columns; ++col) {
+            const short index = static_cast<short>(col);
+            size_t kind = 0;  // SqlValue alternative: 1 integer, 2 real, 3 text
+            for (const auto& row : rows) {
+                if (row.at(col).index() != 0) {
+                    kind = row[col].index();
+                    break;
+                }
+            }
+
+            auto& nulls = bindings.nulls.emplace_back(new bool[batch]());
+            for (size_t r = 0; r < batch; ++r) {
+                const size_t cell = rows[r].at(col).index();
+                nulls[r] = cell == 0;
+                if (cell != 0 && cell != kind) {
+                    throw SqlError("Batch parameter " + std::to_string(col + 1) + " mixes value types");
+                }
+            }
+
+            if (kind == 3) {
+                auto& values = bindings.text.emplace_back(batch);
+                for (size_t r = 0; r < batch; ++r) {
+                    if (!nulls[r]) values[r] = utf8_to_wstring(std::get<std::string>(rows[r][col]));
+                }
+                stmt.bind_strings(index, values, nulls.get());
+            } else if (kind == 1) {
+                auto& values = bindings.integers.emplace_back(batch);
+                for (size_t r = 0; r < batch; ++r) {
+                    if (!nulls[r]) values[r] = std::get<long long>(rows[r][col]);
+                }
+                stmt.bind(index, values.data(), batch, nulls.get());
+            } else if (kind == 2) {
+                auto& values = bindings.reals.emplace_back(batch);
+                for (size_t r = 0; r < batch; ++r) {
+                    if (!nulls[r]) values[r] = std::get<double>(rows[r][col]);
+                }
+                stmt.bind(index, values.data(), batch, nulls.get());
+            } else {
+                stmt.bind_null(index, batch);
+            }
+        }
+    }
+
+    // SQLSTATE class 23 is an integrity constraint violation
+    static SqlError translate(const nanodbc::database_error& e) {
+        return SqlError(e.what(), e.state().rfind("23", 0) == 0);
+    }
+
+    ConnectionLease<OdbcConnection> conn_;
+    bool narrow_;
+    std::unique_ptr<nanodbc::transaction> transaction_;
+};
+
+class OdbcDatabase : public SqlDatabase {
+public:
+    OdbcDatabase(OdbcOptions options, PoolOptions pool_options)
+        : options_(std::move(options)),
+          pool_([this] { return std::make_unique<OdbcConnection>(options_.connection_string); },
+                validate, pool_options) {}
+
+    SqlDialect dialect() const override { return SqlDialect::sql_server; }
+    const char* name() const override { return "sqlserver"; }
+
+    std::unique_ptr<SqlSession> session() override {
+        PhaseTimer timer(RequestPhase::pool_wait);
+        return std::make_unique<OdbcSession>(pool_.acquire(), options_.narrow_text_fetch);
+    }
+
+    PoolStats pool_stats() const override { return pool_.stats(); }
+
+private:
+    // Round-trips a trivial query so dead sessions are caught before they reach a handler
+    static bool validate(OdbcConnection& conn) {
+        if (!conn.connected()) return false;
+        try {
+            nanodbc::just_execute(conn.native(), NANODBC_TEXT("SELECT 1"));
+            return true;
+        } catch (const nanodbc::database_error&) {
+            return false;
+        }
+    }
+
+    OdbcOptions options_;
+    BasicConnectionPool<OdbcConnection> pool_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "book_search.h"
+#include "models.h"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Table-level access used by the HTTP handlers.
+//
+// Each repository owns the SQL text, column order and binding for one table, so handlers only
+// deal in Book/Reader/Record values. A StorageSession groups the three repositories over one
+// connection (and one transaction, when begin() is called); a Storage hands out sessions.
+// Implementations: SqlStorage (SQL Server or SQLite, sql_repository.h), MemoryStorage
+// (memory_storage.h) and CachedStorage, which puts a MemoryStorage in front of another
+// Storage (cached_storage.h).
+//
+// Whatever the engine, failures are reported as SqlError; constraint_violation() is set
+// when a key is already taken.
+
+// Visitor for listings; the row may be reused between calls, so copy what you keep
+template <class Row>
+using RowSink = std::function<void(const Row&)>;
+
+// Which part of the book table a listing returns
+struct BookScan {
+    long long limit = 0;  // 0 returns every row, in no particular order
+    long long offset = 0;
+    std::string after;    // Keyset cursor: only ids greater than this; ignored when offset is set
+};
+
+// Outcome of BookRepository::insert_many
+struct BulkInsertResult {
+    long long inserted = 0;
+    std::vector<size_t> duplicates;  // Indexes of input rows whose book_id was already taken
+};
+
+class BookRepository {
+public:
+    virtual ~BookRepository() = default;
+
+    // Limited scans are ordered by book_id; returns the number of rows visited
+    virtual long long scan(const BookScan& scan, const RowSink<Book>& sink) = 0;
+    virtual long long count() = 0;
+    virtual std::optional<Book> find(const std::string& book_id) = 0;
+    // Appends the access path of every predicate to plan
+    virtual long long search(const BookSearchRequest& request, const RowSink<Book>& sink, std::vector<std::string>& plan) = 0;
+    virtual void insert(const Book& book) = 0;
+    // Inserts books batch_size rows per statement. Rows whose book_id exists, or repeats an
+    // earlier row, are skipped and reported instead of failing the call; run it inside a
+    // transaction for all-or-nothing semantics on other errors.
+    virtual BulkInsertResult insert_many(const std::vector<Book>& books, size_t batch_size) = 0;
+    // False when there is no row with that key
+    virtual bool update(const Book& book) = 0;
+    virtual bool remove(const std::string& book_id) = 0;
+};
+
+class ReaderRepository {
+public:
+    virtual ~ReaderRepository() = default;
+
+    virtual long long scan(const RowSink<Reader>& sink) = 0;
+    virtual std::optional<Reader> find(const std::string& reader_id) = 0;
+    virtual void insert(const Reader& reader) = 0;
+    virtual bool update(const Reader& reader) = 0;
+    virtual bool remove(const std::string& reader_id) = 0;
+};
+
+// Records are keyed by (book_id, reader_id)
+class RecordRepository {
+public:
+    virtual ~RecordRepository() = default;
+
+    virtual long long scan(const RowSink<Record>& sink) = 0;
+    virtual std::optional<Record> find(const std::string& book_id, const std::string& reader_id) = 0;
+    virtual void insert(const Record& record) = 0;
+    virtual bool update(const Record& record) = 0;
+    virtual bool remove(const std::string& book_id, const std::string& reader_id) = 0;
+};
+
+class StorageSession {
+public:
+    virtual ~StorageSession() = default;
+
+    virtual BookRepository& books() = 0;
+    virtual ReaderRepository& readers() = 0;
+    virtual RecordRepository& records() = 0;
+
+    // An open transaction is rolled back if the session is destroyed before commit()
+    virtual void begin() = 0;
+    virtual void commit() = 0;
+    virtual void rollback() = 0;
+};
+
+class Storage {
+public:
+    virtual ~Storage() = default;
+
+    virtual const char* name() const = 0;
+    // Throws PoolExhaustedError when a SQL backend has no connection to spare
+    virtual std::unique_ptr<StorageSession> session() = 0;
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where a request's time goes, recorded on the thread that runs its handler.
+//
+// PhaseTimer scopes along the call path attribute time to one phase at a time:
+//   db_queue   waiting for a database executor thread (db_executor.h)
+//   pool_wait  checking a connection out of the pool (SqlDatabase::session)
+//   execute    preparing, binding and running a statement up to its first row; commits
+//   fetch      stepping through the remaining rows
+//   transcode  UTF-16 to UTF-8 conversion of fetched text (ODBC)
+//   serialize  encoding rows as JSON, CSV or columnar output
+//   compress   gzip, deflate or zstd encoding of the response body (compression.h)
+// Phases are exclusive: a scope opened inside another, such as a row callback that serializes
+// during a fetch, pauses the outer clock until it closes. Outside a request every scope costs
+// one branch.
+//
+// A request handed to another thread takes its timings along: detach() on the thread giving
+// it up, attach() on the one picking it up.
+//
+// SQL sessions also note each statement and its bind parameters (the first few of each, cut
+// short), so a request that turns out slow can be logged with what it ran.
+
+enum class RequestPhase : uint8_t { db_queue, pool_wait, execute, fetch, transcode, serialize, compress };
+
+constexpr size_t request_phase_count = 7;
+constexpr const char* request_phase_names[request_phase_count] = {"db_queue", "pool_wait", "execute", "fetch", "transcode", "serialize", "compress"};
+
+class PhaseClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Statements noted per request; later ones are only counted
+    static constexpr size_t max_statements = 8;
+
+    // What a request has recorded so far, while it moves between threads
+    struct Trace {
+        std::array<uint64_t, request_phase_count> nanoseconds{};
+        std::vector<std::string> statements;
+        size_t statements_total = 0;
+    };
+
+    static PhaseClock& current() {
+        thread_local PhaseClock clock;
+        return clock;
+    }
+
+    // Called when a request starts
+    void start() {
+        active_ = true;
+        current_ = -1;
+        nanoseconds_.fill(0);
+        statements_.clear();
+        statements_total_ = 0;
+    }
+
+    // Called when it ends; nanoseconds spent in each phase
+    std::array<uint64_t, request_phase_count> stop() {
+        if (current_ >= 0) charge(Clock::now());
+        current_ = -1;
+        active_ = false;
+        return nanoseconds_;
+    }
+
+    bool active() const { return active_; }
+
+    // Stops timing on this thread and hands over the request's timings; nothing is recorded here
+    // until the next start() or attach()
+    Trace detach() {
+        Trace trace;
+        if (!active_) return trace;
+        if (current_ >= 0) charge(Clock::now());
+        trace.nanoseconds = nanoseconds_;
+        trace.statements = std::move(statements_);
+        trace.statements_total = statements_total_;
+        statements_.clear();
+        current_ = -1;
+        active_ = false;
+        return trace;
+    }
+
+    // Carries on timing a request detach()ed on another thread
+    void attach(Trace trace) {
+        active_ = true;
+        current_ = -1;
+        nanoseconds_ = trace.nanoseconds;
+        statements_ = std::move(trace.statements);
+        statements_total_ = trace.statements_total;
+    }
+
+    // Charges time spent outside any PhaseTimer scope, such as a queue wait, to phase
+    void add(RequestPhase phase, Clock::duration elapsed) {
+        if (!active_) return;
+        nanoseconds_[static_cast<size_t>(phase)] +=
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    // Switches to phase and returns the phase to resume afterwards
+    int enter(RequestPhase phase) {
+        const auto now = Clock::now();
+        if (current_ >= 0) charge(now);
+        const int previous = current_;
+        current_ = static_cast<int>(phase);
+        since_ = now;
+        return previous;
+    }
+
+    void leave(int previous) {
+        const auto now = Clock::now();
+        charge(now);
+        current_ = previous;
+        since_ = now;
+    }
+
+    // True when the caller should describe its statement to note_statement()
+    bool wants_statement() {
+        if (!active_) return false;
+        return ++statements_total_ <= max_statements;
+    }
+
+    void note_statement(std::string description) { statements_.push_back(std::move(description)); }
+
+    // Statements of the request that just stopped, and how many it ran in all
+    const std::vector<std::string>& statements() const { return statements_; }
+    size_t statements_total() const { return statements_total_; }
+
+private:
+    void charge(Clock::time_point now) {
+        nanoseconds_[static_cast<size_t>(current_)] +=
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - since_).count());
+    }
+
+    bool active_ = false;
+    int current_ = -1;
+    Clock::time_point since_;
+    std::array<uint64_t, request_phase_count> nanoseconds_{};
+    std::vector<std::string> statements_;
+    size_t statements_total_ = 0;
+};
+
+// Attributes the enclosing scope to a phase of the request running on this thread
+class PhaseTimer {
+public:
+    explicit PhaseTimer(RequestPhase phase) {
+        PhaseClock& clock = PhaseClock::current();
+        if (!clock.active()) return;
+        clock_ = &clock;
+        previous_ = clock.enter(phase);
+    }
+
+    ~PhaseTimer() {
+        if (clock_) clock_->leave(previous_);
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    // Moves the rest of the scope to another phase, e.g. from execute to fetch
+    void change(RequestPhase phase) {
+        if (clock_) clock_->enter(phase);
+    }
+
+private:
+    PhaseClock* clock_ = nullptr;
+    int previous_ = -1;
+};
+
+// Decides which slow requests get logged: those at or over threshold, at most per_second of
+// them in any one second; the rest are counted and reported with the next line that is logged
+class SlowRequestLog {
+public:
+    SlowRequestLog(std::chrono::milliseconds threshold, size_t per_second)
+        : threshold_(threshold), per_second_(per_second) {}
+
+    bool enabled() const { return threshold_.count() > 0 && per_second_ > 0; }
+    std::chrono::milliseconds threshold() const { return threshold_; }
+
+    // True when this request should be logged; suppressed is how many were skipped since the last one
+    bool admit(std::chrono::steady_clock::duration elapsed, uint64_t& suppressed) {
+        if (!enabled() || elapsed < threshold_) return false;
+        const int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t window = window_.load(std::memory_order_relaxed);
+        if (window != second && window_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+            logged_in_window_.store(0, std::memory_order_relaxed);
+        }
+        if (logged_in_window_.fetch_add(1, std::memory_order_relaxed) >= per_second_) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    std::chrono::milliseconds threshold_;
+    size_t per_second_;
+    std::atomic<int64_t> window_{0};
+    std::atomic<size_t> logged_in_window_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
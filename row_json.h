@@ -0,0 +1,122 @@
+#pragma once
+
+#include "json_writer.h"
+#include "models.h"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Fixed-schema JSON serialization for the row types in models.h.
+//
+// Each row type lists its members once in a RowSchema specialization; append_row_json then
+// unrolls that list at compile time into a straight sequence of appends. There is no key
+// lookup, no intermediate tree and no allocation beyond growing out. The "key": prefixes are
+// literals, so they are copied, not escaped. Member order is the column order of the
+// matching SELECT.
+
+template <class Row, class Member>
+struct RowField {
+    std::string_view prefix;  // "\"key\":", including quotes and colon
+    Member Row::*member;
+};
+
+template <size_t N, class Row, class Member>
+constexpr RowField<Row, Member> row_field(const char (&prefix)[N], Member Row::*member) {
+    return {std::string_view(prefix, N - 1), member};
+}
+
+template <class Row>
+struct RowSchema;
+
+// Column name of a field: the key inside its "\"key\":" prefix
+template <class Row, class Member>
+constexpr std::string_view row_field_name(const RowField<Row, Member>& field) {
+    return field.prefix.substr(1, field.prefix.size() - 3);
+}
+
+// Calls f(field) for every field of Row's schema, in column order
+template <class Row, class F>
+void for_each_row_field(F&& f) {
+    std::apply([&](const auto&... field) { (f(field), ...); }, RowSchema<Row>::fields);
+}
+
+template <>
+struct RowSchema<Book> {
+    static constexpr auto fields = std::make_tuple(
+        row_field("\"book_id\":", &Book::book_id),
+        row_field("\"book_name\":", &Book::book_name),
+        row_field("\"book_isbn\":", &Book::book_isbn),
+        row_field("\"book_author\":", &Book::book_author),
+        row_field("\"book_publisher\":", &Book::book_publisher),
+        row_field("\"interview_times\":", &Book::interview_times),
+        row_field("\"book_price\":", &Book::book_price));
+};
+
+template <>
+struct RowSchema<Reader> {
+    static constexpr auto fields = std::make_tuple(
+        row_field("\"reader_id\":", &Reader::reader_id),
+        row_field("\"reader_name\":", &Reader::reader_name),
+        row_field("\"reader_sex\":", &Reader::reader_sex),
+        row_field("\"reader_department\":", &Reader::reader_department));
+};
+
+template <>
+struct RowSchema<Record> {
+    static constexpr auto fields = std::make_tuple(
+        row_field("\"reader_id\":", &Record::reader_id),
+        row_field("\"book_id\":", &Record::book_id),
+        row_field("\"borrow_date\":", &Record::borrow_date),
+        row_field("\"return_date\":", &Record::return_date),
+        row_field("\"notes\":", &Record::notes));
+};
+
+namespace row_json_detail {
+
+inline void append_value(std::string& out, const std::string& value) { append_json_string(out, value); }
+inline void append_value(std::string& out, double value) { append_json_number(out, value); }
+
+template <class Int, std::enable_if_t<std::is_integral_v<Int>, int> = 0>
+void append_value(std::string& out, Int value) {
+    append_json_number(out, static_cast<long long>(value));
+}
+
+template <class T>
+void append_value(std::string& out, const std::optional<T>& value) {
+    if (value) {
+        append_value(out, *value);
+    } else {
+        out.append("null");
+    }
+}
+
+template <size_t I, class Row, class Field>
+void append_field(std::string& out, const Row& row, const Field& field) {
+    if constexpr (I > 0) out.push_back(',');
+    out.append(field.prefix);
+    append_value(out, row.*(field.member));
+}
+
+template <class Row, class Fields, size_t... I>
+void append_fields(std::string& out, const Row& row, const Fields& fields, std::index_sequence<I...>) {
+    (append_field<I>(out, row, std::get<I>(fields)), ...);
+}
+
+}  // namespace row_json_detail
+
+// Append row's members as "key":value pairs, without the braces, so callers can add fields
+template <class Row>
+void append_row_fields(std::string& out, const Row& row) {
+    constexpr auto& fields = RowSchema<Row>::fields;
+    row_json_detail::append_fields(out, row, fields, std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(fields)>>>{});
+}
+
+// Append row as a JSON object
+template <class Row>
+void append_row_json(std::string& out, const Row& row) {
+    out.push_back('{');
+    append_row_fields(out, row);
+    out.push_back('}');
+}
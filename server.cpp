@@ -1,75 +1,137 @@
+#if __has_include(<crow.h>)
 #include <crow.h>
-#include <nanodbc/nanodbc.h>
+#else
+#include "crow_all.h"  // Single-header Crow vendored under tmp/include
+#endif
 #include <string>
 #include <mutex>
 #include <iostream>
 #include <vector>
+#include <optional>
+#include <variant>
 #include <memory>
-#include <windows.h>
-#include <locale>
-#include <codecvt>
+#include <cstdlib>
+#include <cctype>
+#include <ctime>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <type_traits>
+#include "async_storage.h"
+#include "connection_pool.h"
+#include "db_executor.h"
+#include "sql_database.h"
+#include "sqlite_database.h"
+#include "repository.h"
+#include "sql_repository.h"
+#include "memory_storage.h"
+#include "cached_storage.h"
+#if LIBRARY_WITH_ODBC
+#include "odbc_database.h"
+#endif
+#include "row_json.h"
+#include "book_search.h"
+#include "book_index.h"
+#include "catalog_cache.h"
+#include "catalog_import.h"
+#include "compression.h"
+#include "export.h"
+#include "static_assets.h"
+#include "metrics.h"
+#include "async_log.h"
+#include "models.h"
 
-// Helper function to convert UTF-8 std::string to std::wstring
-std::wstring utf8_to_wstring(const std::string& str) {
-    if (str.empty()) return std::wstring();
-    int size_needed = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
-    std::wstring wstrTo(size_needed, 0);
-    MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], size_needed);
-    return wstrTo;
-}
-
-// Helper function to convert std::wstring to UTF-8 std::string
-std::string wstring_to_utf8(const std::wstring& wstr) {
-    if (wstr.empty()) return std::string();
-    int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
-    std::string strTo(size_needed, 0);
-    WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], size_needed, NULL, NULL);
-    return strTo;
-}
+// Where the front-end files are when LIBRARY_STATIC_DIR is not set (CMake passes the source directory)
+#ifndef LIBRARY_DEFAULT_STATIC_DIR
+#define LIBRARY_DEFAULT_STATIC_DIR "."
+#endif
 
+#if LIBRARY_WITH_ODBC
 // Database connection string for SQL Server
 // IMPORTANT: 
 // 1. Make sure "ODBC Driver 17 for SQL Server" is installed on your system.
 // 2. Change Server, UID, and PWD to match your SQL Server configuration.
 const nanodbc::string connection_string = NANODBC_TEXT("Driver={ODBC Driver 17 for SQL Server};Server=localhost;Database=JY;UID=sa;PWD=Eld_4ever;");
+#endif
 
-// A simple connection pool
-class ConnectionPool {
-public:
-    ConnectionPool(const nanodbc::string& conn_str, size_t size) : connection_string_(conn_str) {
-        for (size_t i = 0; i < size; ++i) {
-            try {
-                pool_.push_back(std::make_unique<nanodbc::connection>(connection_string_));
-            } catch (const nanodbc::database_error& e) {
-                std::cerr << "Error creating connection for pool: " << e.what() << std::endl;
-            }
-        }
+// Pool sizing; each value can be overridden through the environment for load testing
+size_t env_or(const char* name, size_t fallback) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) return fallback;
+    try {
+        return static_cast<size_t>(std::stoul(value));
+    } catch (const std::exception&) {
+        return fallback;
     }
+}
 
-    std::unique_ptr<nanodbc::connection> get_connection() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (pool_.empty()) {
-            // Or wait, or throw an exception
-            return std::make_unique<nanodbc::connection>(connection_string_);
-        }
-        auto conn = std::move(pool_.back());
-        pool_.pop_back();
-        return conn;
-    }
+std::string env_or(const char* name, const std::string& fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? std::string(value) : fallback;
+}
 
-    void return_connection(std::unique_ptr<nanodbc::connection> conn) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        pool_.push_back(std::move(conn));
-    }
+// Console log writer installed by main (LIBRARY_LOG_ASYNC=0 keeps Crow's synchronous one).
+// Declared first so it is destroyed last and still flushes what the other globals log.
+std::unique_ptr<AsyncLogHandler> async_log;
 
-private:
-    std::mutex mutex_;
-    nanodbc::string connection_string_;
-    std::vector<std::unique_ptr<nanodbc::connection>> pool_;
-};
+// Database behind the SQL backends; null for LIBRARY_STORAGE=memory
+std::unique_ptr<SqlDatabase> db;
+
+// Repositories the handlers use, selected at startup (LIBRARY_STORAGE, LIBRARY_CACHE_TIER)
+std::unique_ptr<Storage> storage;
+
+// Full-text index over the book table, kept in step with POST/PUT/DELETE
+BookIndex book_index;
+
+// Serialized catalog and single-book rows, invalidated by POST/PUT/DELETE
+CatalogCache catalog_cache;
+
+// Running and recently finished catalog imports (POST /api/imports)
+ImportRegistry imports;
+
+// index.html and the other front-end files, served from memory (LIBRARY_STATIC_DIR)
+StaticAssets static_assets;
 
-// Global connection pool
-std::unique_ptr<ConnectionPool> db_pool;
+// Threads the handlers hand database work to (LIBRARY_DB_THREADS, LIBRARY_DB_QUEUE); null for
+// in-memory storage and for LIBRARY_DB_THREADS=0, where handlers query on Crow's I/O threads.
+// Declared after the storage it uses, so queued jobs finish before that is torn down.
+std::unique_ptr<DbExecutor> db_executor;
+
+// Latency, phase, byte and status counters per route and method (GET /metrics). Static
+// routes come before the parameterized ones they overlap with.
+RequestMetrics request_metrics(
+    {"/api/books", "/api/books/search", "/api/books/bulk", "/api/books/<book_id>", "/api/batch",
+     "/api/imports", "/api/imports/<import_id>", "/api/readers", "/api/readers/<reader_id>",
+     "/api/records", "/api/records/<book_id>/<reader_id>", "/api/export/<table>",
+     "/api/pool/stats", "/api/cache/stats", "/metrics", "/", "/index.html", "/static/<file>"},
+    {"GET", "POST", "PUT", "DELETE", "OPTIONS"});
+
+// Response compression (LIBRARY_COMPRESSION=0 turns it off). Bodies under
+// LIBRARY_COMPRESS_MIN_BYTES (default 1024) are sent as they are; LIBRARY_COMPRESS_LEVEL sets
+// the gzip/deflate level (default 6).
+const bool compression_enabled = env_or("LIBRARY_COMPRESSION", 1) != 0;
+const CompressionOptions compression_options = [] {
+    CompressionOptions options;
+    options.min_bytes = env_or("LIBRARY_COMPRESS_MIN_BYTES", options.min_bytes);
+    options.zlib_level = static_cast<int>(std::min<size_t>(env_or("LIBRARY_COMPRESS_LEVEL", static_cast<size_t>(options.zlib_level)), 9));
+    return options;
+}();
+CompressionCounters compression_counters;
+
+// Coding to answer req in, from its Accept-Encoding; identity when compression is off
+ContentCoding response_coding(const crow::request& req) {
+    if (!compression_enabled) return ContentCoding::identity;
+    return negotiate_coding(req.get_header_value("Accept-Encoding"));
+}
+
+// body encoded with coding, timed as the request's compress phase
+std::string encode_body(ContentCoding coding, std::string_view body) {
+    PhaseTimer timer(RequestPhase::compress);
+    std::string encoded = compress_body(coding, body, compression_options);
+    compression_counters.record_encode(coding, body.size(), encoded.size());
+    return encoded;
+}
 
 
 struct CORSHandler {
@@ -92,200 +154,1690 @@ struct CORSHandler {
         res.add_header("Access-Control-Allow-Origin", "*");
         res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
         res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
+        res.add_header("Access-Control-Expose-Headers", "X-Total-Count, X-Next-After, ETag");
     }
 };
 
-// Initialize database connection pool
+// Compresses response bodies for clients that accept it. Listed last in the App so its
+// after_handle runs first: the metrics then count the bytes actually sent, and the time goes
+// into the compress phase. Leaves alone bodies under the size threshold, static files (exports
+// encode their own), binary types and responses whose handler already chose a coding (it set
+// Content-Encoding or Vary), such as the catalog reads and the front-end files.
+struct CompressionMiddleware {
+    struct context {};
+
+    void before_handle(crow::request&, crow::response&, context&) {}
+
+    void after_handle(crow::request& req, crow::response& res, context&) {
+        if (!compression_enabled || res.is_static_type() || res.body.size() < compression_options.min_bytes) return;
+        if (!res.get_header_value("Content-Encoding").empty() || !res.get_header_value("Vary").empty()) return;
+        if (!compressible_type(res.get_header_value("Content-Type"))) return;
+        res.set_header("Vary", "Accept-Encoding");
+        const ContentCoding coding = response_coding(req);
+        if (coding == ContentCoding::identity) return;
+        try {
+            res.body = encode_body(coding, res.body);
+        } catch (const std::exception& e) {
+            CROW_LOG_WARNING << "Sending " << req.url << " uncompressed: " << e.what();
+            return;
+        }
+        res.set_header("Content-Encoding", content_coding_names[static_cast<size_t>(coding)]);
+        const std::string etag = res.get_header_value("ETag");
+        if (!etag.empty()) res.set_header("ETag", etag_for_coding(etag, coding));
+        compression_counters.record_response(coding);
+    }
+};
+
+// Requests at or over LIBRARY_SLOW_REQUEST_MS (default 500, 0 turns the log off) are logged
+// with their phase breakdown and SQL, at most LIBRARY_SLOW_REQUEST_LOG_RATE (default 5) a second
+SlowRequestLog slow_requests(std::chrono::milliseconds(env_or("LIBRARY_SLOW_REQUEST_MS", 500)),
+                             env_or("LIBRARY_SLOW_REQUEST_LOG_RATE", 5));
+
+// Send the phase breakdown in a Server-Timing header (LIBRARY_SERVER_TIMING=0 turns it off)
+const bool server_timing = env_or("LIBRARY_SERVER_TIMING", 1) != 0;
+
+// "name;dur=ms" entries for the phases a request went through, then its total
+std::string server_timing_header(const std::array<uint64_t, request_phase_count>& phase_ns, std::chrono::steady_clock::duration total) {
+    std::string header;
+    char buffer[64];
+    for (size_t i = 0; i < request_phase_count; ++i) {
+        if (phase_ns[i] == 0) continue;
+        std::snprintf(buffer, sizeof(buffer), "%s;dur=%.3f, ", request_phase_names[i], static_cast<double>(phase_ns[i]) / 1e6);
+        header += buffer;
+    }
+    std::snprintf(buffer, sizeof(buffer), "total;dur=%.3f", std::chrono::duration<double, std::milli>(total).count());
+    header += buffer;
+    return header;
+}
+
+void log_slow_request(const crow::request& req, int status, std::chrono::steady_clock::duration total,
+                      const std::array<uint64_t, request_phase_count>& phase_ns, uint64_t suppressed) {
+    const PhaseClock& clock = PhaseClock::current();
+    std::ostringstream line;
+    line << "Slow request " << crow::method_name(req.method) << " " << req.raw_url << " -> " << status << " in "
+         << std::chrono::duration<double, std::milli>(total).count() << " ms (" << server_timing_header(phase_ns, total) << ")";
+    if (clock.statements_total() > 0) {
+        line << "; " << clock.statements_total() << " statement(s):";
+        for (const auto& statement : clock.statements()) line << "\n    " << statement;
+        if (clock.statements_total() > clock.statements().size()) {
+            line << "\n    ... and " << clock.statements_total() - clock.statements().size() << " more";
+        }
+    }
+    if (suppressed > 0) line << "\n    (" << suppressed << " earlier slow requests not logged)";
+    CROW_LOG_WARNING << line.str();
+}
+
+// Times every request into request_metrics, adds Server-Timing and feeds the slow-request log.
+// Listed first in the App so it wraps the other middleware; handlers run on the thread that
+// called before_handle, which PhaseClock relies on.
+struct RequestMetricsMiddleware {
+    struct context {
+        bool started = false;
+        size_t series = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void before_handle(crow::request& req, crow::response&, context& ctx) {
+        ctx.series = request_metrics.series(req.url, crow::method_name(req.method));
+        ctx.start = std::chrono::steady_clock::now();
+        ctx.started = true;
+        request_metrics.begin(ctx.series);
+        PhaseClock::current().start();
+    }
+
+    void after_handle(crow::request& req, crow::response& res, context& ctx) {
+        // Crow skips before_handle when no route matched, but still calls this for the 404
+        if (!ctx.started) before_handle(req, res, ctx);
+        const auto phases = PhaseClock::current().stop();
+        const auto elapsed = std::chrono::steady_clock::now() - ctx.start;
+        uint64_t bytes = res.body.size();
+        if (res.is_static_type()) bytes = std::strtoull(res.get_header_value("Content-Length").c_str(), nullptr, 10);
+        request_metrics.end(ctx.series, elapsed, res.code, bytes, phases);
+
+        if (server_timing) {
+            res.set_header("Server-Timing", server_timing_header(phases, elapsed));
+            res.set_header("Timing-Allow-Origin", "*");
+        }
+        uint64_t suppressed = 0;
+        if (slow_requests.admit(elapsed, suppressed)) log_slow_request(req, res.code, elapsed, phases, suppressed);
+    }
+};
+
+// Open the storage backend. LIBRARY_STORAGE=sqlserver uses the ODBC connection string above,
+// LIBRARY_STORAGE=sqlite an embedded file (LIBRARY_SQLITE_PATH, default library.db) and
+// LIBRARY_STORAGE=memory keeps everything in this process. SQLite is the default; the ODBC
+// backend has to be asked for until it has been run against a real SQL Server with the bulk,
+// batch and CRUD routes. LIBRARY_CACHE_TIER=1 answers reads from an in-memory copy of a SQL
+// backend.
 bool initDatabase() {
+    PoolOptions options;
+    options.max_size = env_or("LIBRARY_POOL_SIZE", 5);
+    options.min_size = env_or("LIBRARY_POOL_MIN", options.max_size);
+    options.acquire_timeout = std::chrono::milliseconds(env_or("LIBRARY_POOL_TIMEOUT_MS", 5000));
+    options.validate_after_idle = std::chrono::milliseconds(env_or("LIBRARY_POOL_VALIDATE_MS", 30000));
+
+    const std::string backend = env_or("LIBRARY_STORAGE", std::string("sqlite"));
+
     try {
-        db_pool = std::make_unique<ConnectionPool>(connection_string, 5); // Pool with 5 connections
-        // Test getting a connection
-        auto conn = db_pool->get_connection();
-        if (conn && conn->connected()) {
-            std::cout << "Database connection pool created successfully." << std::endl;
-            db_pool->return_connection(std::move(conn));
+        if (backend == "memory") {
+            storage = std::make_unique<MemoryStorage>();
+            std::cout << "Using in-memory storage; nothing will be persisted." << std::endl;
             return true;
         }
-    } catch (const nanodbc::database_error& e) {
+
+        if (backend == "sqlite") {
+            SqliteOptions sqlite;
+            sqlite.path = env_or("LIBRARY_SQLITE_PATH", sqlite.path);
+            sqlite.mmap_size = static_cast<long long>(env_or("LIBRARY_SQLITE_MMAP", static_cast<size_t>(sqlite.mmap_size)));
+            db = std::make_unique<SqliteDatabase>(sqlite, options);
+#if LIBRARY_WITH_ODBC
+        } else if (backend == "sqlserver") {
+            OdbcOptions odbc;
+            odbc.connection_string = connection_string;
+            odbc.narrow_text_fetch = env_or("LIBRARY_NARROW_FETCH", 0) != 0;
+            db = std::make_unique<OdbcDatabase>(odbc, options);
+#endif
+        } else {
+            std::cerr << "Unknown or unsupported LIBRARY_STORAGE: " << backend << std::endl;
+            return false;
+        }
+
+        // Test getting a connection
+        db->session();
+        std::cout << "Database connection pool created successfully (" << db->name() << ", max " << options.max_size << " connections)." << std::endl;
+
+        storage = std::make_unique<SqlStorage>(*db);
+        if (env_or("LIBRARY_CACHE_TIER", 0)) {
+            auto cached = std::make_unique<CachedStorage>(std::move(storage));
+            const long long books = cached->warm();
+            std::cout << "Cache tier loaded " << books << " books." << std::endl;
+            storage = std::move(cached);
+        }
+        return true;
+    } catch (const SqlError& e) {
+        std::cerr << "Database connection failed: " << e.what() << std::endl;
+    } catch (const PoolExhaustedError& e) {
         std::cerr << "Database connection failed: " << e.what() << std::endl;
-        return false;
     }
     return false;
 }
 
+// Pool and prepared-statement counters, exposed so the pool can be sized under load
+crow::json::wvalue pool_stats_json(const PoolStats& stats) {
+    crow::json::wvalue json;
+    json["max_size"] = stats.max_size;
+    json["open"] = stats.open;
+    json["idle"] = stats.idle;
+    json["in_use"] = stats.in_use;
+    json["waiting"] = stats.waiting;
+    json["checkouts_total"] = stats.checkouts_total;
+    json["checkouts_per_sec"] = stats.checkouts_per_sec;
+    json["exhaustion_events"] = stats.exhaustion_events;
+    json["connect_failures"] = stats.connect_failures;
+    json["validation_failures"] = stats.validation_failures;
+    json["discarded"] = stats.discarded;
+    json["wait_time_total_us"] = stats.wait_time_total_us;
+
+    std::vector<crow::json::wvalue> buckets;
+    for (size_t i = 0; i < stats.wait_histogram.size(); ++i) {
+        crow::json::wvalue bucket;
+        if (i < pool_wait_buckets_us.size()) {
+            bucket["le_us"] = pool_wait_buckets_us[i];
+        } else {
+            bucket["le_us"] = "+Inf";
+        }
+        bucket["count"] = stats.wait_histogram[i];
+        buckets.push_back(std::move(bucket));
+    }
+    json["wait_histogram"] = std::move(buckets);
+
+    crow::json::wvalue statements;
+    statements["prepare_hits"] = StatementCacheStats::hits.load(std::memory_order_relaxed);
+    statements["prepare_misses"] = StatementCacheStats::misses.load(std::memory_order_relaxed);
+    statements["evictions"] = StatementCacheStats::evictions.load(std::memory_order_relaxed);
+    json["statement_cache"] = std::move(statements);
+    return json;
+}
+
+// The same pool counters in the Prometheus text format, for GET /metrics
+void append_pool_metrics(std::string& out, const PoolStats& stats, const char* backend) {
+    const std::string labels = std::string("backend=\"") + backend + "\"";
+    append_metric_header(out, "library_db_pool_connections", "gauge", "Pooled database connections by state");
+    append_metric(out, "library_db_pool_connections", labels + ",state=\"open\"", static_cast<double>(stats.open));
+    append_metric(out, "library_db_pool_connections", labels + ",state=\"idle\"", static_cast<double>(stats.idle));
+    append_metric(out, "library_db_pool_connections", labels + ",state=\"in_use\"", static_cast<double>(stats.in_use));
+    append_metric(out, "library_db_pool_connections", labels + ",state=\"max\"", static_cast<double>(stats.max_size));
+    append_metric_header(out, "library_db_pool_waiting", "gauge", "Threads waiting for a pooled connection");
+    append_metric(out, "library_db_pool_waiting", labels, static_cast<double>(stats.waiting));
+    append_metric_header(out, "library_db_pool_exhausted_total", "counter", "Checkouts that timed out");
+    append_metric(out, "library_db_pool_exhausted_total", labels, static_cast<double>(stats.exhaustion_events));
+    append_metric_header(out, "library_db_pool_connect_failures_total", "counter", "Failed connection attempts");
+    append_metric(out, "library_db_pool_connect_failures_total", labels, static_cast<double>(stats.connect_failures));
+
+    append_metric_header(out, "library_db_pool_checkout_wait_seconds", "histogram", "Time a checkout waited for a connection");
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < stats.wait_histogram.size(); ++i) {
+        cumulative += stats.wait_histogram[i];
+        std::string le = labels + ",le=\"";
+        if (i < pool_wait_buckets_us.size()) {
+            append_metric_number(le, static_cast<double>(pool_wait_buckets_us[i]) / 1e6);
+        } else {
+            le += "+Inf";
+        }
+        le += "\"";
+        append_metric(out, "library_db_pool_checkout_wait_seconds_bucket", le, static_cast<double>(cumulative));
+    }
+    append_metric(out, "library_db_pool_checkout_wait_seconds_sum", labels, static_cast<double>(stats.wait_time_total_us) / 1e6);
+    append_metric(out, "library_db_pool_checkout_wait_seconds_count", labels, static_cast<double>(stats.checkouts_total));
+}
+
+crow::json::wvalue import_progress_json(const ImportProgress& progress) {
+    crow::json::wvalue json;
+    json["import_id"] = progress.id;
+    json["format"] = progress.format;
+    json["state"] = progress.state;
+    if (!progress.error.empty()) json["error"] = progress.error;
+    json["bytes_total"] = progress.bytes_total;
+    json["bytes_parsed"] = progress.bytes_parsed;
+    json["rows_parsed"] = progress.rows_parsed;
+    json["rows_inserted"] = progress.rows_inserted;
+    json["rows_duplicate"] = progress.rows_duplicate;
+    json["rows_rejected"] = progress.rows_rejected;
+    json["rows_transcoded"] = progress.rows_transcoded;
+    json["elapsed_ms"] = progress.elapsed_seconds * 1000.0;
+    json["rows_per_sec"] = progress.rows_per_sec;
+
+    std::vector<crow::json::wvalue> errors;
+    errors.reserve(progress.errors.size());
+    for (const auto& error : progress.errors) {
+        crow::json::wvalue entry;
+        entry["line"] = error.line;
+        entry["error"] = error.message;
+        errors.push_back(std::move(entry));
+    }
+    json["errors"] = std::move(errors);
+    return json;
+}
+
+// Database executor load, for GET /metrics
+void append_executor_metrics(std::string& out, const ExecutorStats& stats) {
+    append_metric_header(out, "library_db_executor_threads", "gauge", "Database executor threads by state");
+    append_metric(out, "library_db_executor_threads", "state=\"busy\"", static_cast<double>(stats.busy));
+    append_metric(out, "library_db_executor_threads", "state=\"idle\"", static_cast<double>(stats.threads - std::min(stats.busy, stats.threads)));
+    append_metric_header(out, "library_db_executor_queue_depth", "gauge", "Requests waiting for a database executor thread");
+    append_metric(out, "library_db_executor_queue_depth", "", static_cast<double>(stats.queued));
+    append_metric_header(out, "library_db_executor_queue_limit", "gauge", "Queue depth at which requests are turned away");
+    append_metric(out, "library_db_executor_queue_limit", "", static_cast<double>(stats.queue_limit));
+    append_metric_header(out, "library_db_executor_jobs_total", "counter", "Database executor jobs by outcome");
+    append_metric(out, "library_db_executor_jobs_total", "result=\"completed\"", static_cast<double>(stats.completed));
+    append_metric(out, "library_db_executor_jobs_total", "result=\"rejected\"", static_cast<double>(stats.rejected));
+}
+
+void append_compression_metrics(std::string& out) {
+    append_metric_header(out, "library_http_compressed_responses_total", "counter", "Responses sent with a Content-Encoding, by coding");
+    for (size_t i = 1; i < content_coding_count; ++i) {
+        const ContentCoding coding = static_cast<ContentCoding>(i);
+        if (!coding_available(coding)) continue;
+        append_metric(out, "library_http_compressed_responses_total", std::string("coding=\"") + content_coding_names[i] + "\"",
+                      static_cast<double>(compression_counters.responses(coding)));
+    }
+    append_metric_header(out, "library_http_compression_bytes_total", "counter", "Bytes into and out of response compression, by coding");
+    for (size_t i = 1; i < content_coding_count; ++i) {
+        const ContentCoding coding = static_cast<ContentCoding>(i);
+        if (!coding_available(coding)) continue;
+        const std::string labels = std::string("coding=\"") + content_coding_names[i] + "\"";
+        append_metric(out, "library_http_compression_bytes_total", labels + ",stage=\"in\"", static_cast<double>(compression_counters.bytes_in(coding)));
+        append_metric(out, "library_http_compression_bytes_total", labels + ",stage=\"out\"", static_cast<double>(compression_counters.bytes_out(coding)));
+    }
+}
+
+crow::response pool_exhausted_response(const PoolExhaustedError& e) {
+    crow::response res(503, std::string(e.what()));
+    res.set_header("Retry-After", "1");
+    return res;
+}
+
+// Answers the request with work(), run on the database executor. The response goes back to
+// the connection's own I/O thread to be sent, carrying the timings recorded while the job ran;
+// a full queue is answered 503 straight away. Without an executor work() runs inline. Either
+// way work is destroyed only after the response is sent, so it may own what the response
+// refers to, such as an export spool.
+template <class Work>
+void answer_from_db(const crow::request& req, crow::response& res, Work work) {
+    if (!db_executor) {
+        res = work();
+        return res.end();
+    }
+
+    const auto queued = std::chrono::steady_clock::now();
+    auto trace = std::make_shared<PhaseClock::Trace>(PhaseClock::current().detach());
+    auto shared_work = std::make_shared<Work>(std::move(work));
+    const bool accepted = db_executor->submit([&req, &res, shared_work, trace, queued] {
+        PhaseClock& clock = PhaseClock::current();
+        clock.attach(std::move(*trace));
+        clock.add(RequestPhase::db_queue, std::chrono::steady_clock::now() - queued);
+        auto result = std::make_shared<crow::response>();
+        try {
+            *result = (*shared_work)();
+        } catch (const std::exception& e) {
+            CROW_LOG_ERROR << "Unhandled error in " << req.url << ": " << e.what();
+            *result = crow::response(500);
+        }
+        *trace = clock.detach();
+        asio::post(*req.io_context, [&res, result, trace, shared_work] {
+            PhaseClock::current().attach(std::move(*trace));
+            res = std::move(*result);
+            res.end();
+        });
+    });
+    if (!accepted) {
+        PhaseClock::current().attach(std::move(*trace));
+        res = crow::response(503, "Database queue is full");
+        res.set_header("Retry-After", "1");
+        res.end();
+    }
+}
+
+// Storage for coroutine handlers: co_await async_db().books().find(id) and the like run on the
+// database executor, or inline when there is none
+AsyncStorage async_db() {
+    return AsyncStorage(*storage, db_executor.get());
+}
+
+// Route handler for a coroutine: handler takes the route's Args (after the request, when it
+// wants it) and returns asio::awaitable<crow::response>. It runs on the connection's I/O thread
+// and suspends at each co_await on async_db(), so a request waiting on the database holds no
+// thread. A full database queue is answered 503.
+template <class... Args, class Handler>
+auto co_route(Handler handler) {
+    return [handler](const crow::request& req, crow::response& res, Args... args) {
+        asio::co_spawn(*req.io_context, [handler, &req, &res, trace = PhaseClock::current().detach(), args...]() mutable -> asio::awaitable<void> {
+            PhaseClock::current().attach(std::move(trace));
+            crow::response out;
+            try {
+                if constexpr (std::is_invocable_v<const Handler&, const crow::request&, Args...>) {
+                    out = co_await handler(req, args...);
+                } else {
+                    out = co_await handler(args...);
+                }
+            } catch (const DbQueueFullError& e) {
+                out = crow::response(503, e.what());
+                out.set_header("Retry-After", "1");
+            } catch (const std::exception& e) {
+                CROW_LOG_ERROR << "Unhandled error in " << req.url << ": " << e.what();
+                out = crow::response(500);
+            }
+            res = std::move(out);
+            res.end();
+        }, asio::detached);
+    };
+}
+
+// Raw query string of the request ("" when there is none), used as the ETag variant
+std::string query_string(const crow::request& req) {
+    const auto pos = req.raw_url.find('?');
+    return pos == std::string::npos ? std::string() : req.raw_url.substr(pos + 1);
+}
+
+// Let browsers keep the body but revalidate it with If-None-Match on every use. Catalog
+// responses are negotiated: the ETag names the coding the client accepts (etag_for_coding)
+// whether or not the body turns out big enough to compress, so a 304 can carry the same
+// validator as the 200 without building the body. Vary also keeps CompressionMiddleware off
+// these responses; encode_catalog_body() compresses them instead.
+void set_catalog_cache_headers(crow::response& res, const std::string& etag, ContentCoding coding) {
+    res.set_header("ETag", etag_for_coding(etag, coding));
+    res.set_header("Cache-Control", "no-cache");
+    if (compression_enabled) res.set_header("Vary", "Accept-Encoding");
+}
+
+crow::response not_modified_response(const std::string& etag, ContentCoding coding) {
+    crow::response res(304);
+    set_catalog_cache_headers(res, etag, coding);
+    return res;
+}
+
+// Marks res as sent in coding
+void set_content_coding(crow::response& res, ContentCoding coding) {
+    if (coding == ContentCoding::identity) return;
+    res.set_header("Content-Encoding", content_coding_names[static_cast<size_t>(coding)]);
+    compression_counters.record_response(coding);
+}
+
+// Compresses a catalog page or row for coding when it is big enough to be worth it
+void encode_catalog_body(const crow::request& req, crow::response& res, ContentCoding coding) {
+    if (coding == ContentCoding::identity || res.body.size() < compression_options.min_bytes) return;
+    try {
+        res.body = encode_body(coding, res.body);
+    } catch (const std::exception& e) {
+        CROW_LOG_WARNING << "Sending " << req.url << " uncompressed: " << e.what();
+        return;
+    }
+    set_content_coding(res, coding);
+}
+
+// Cached full listing in coding. The first request for a coding at a catalog version compresses
+// the plain listing and caches the result; a listing under the size threshold stays plain and
+// coding becomes identity. body is null when nothing is cached.
+CatalogCache::Listing cached_listing(ContentCoding& coding) {
+    if (coding != ContentCoding::identity) {
+        auto encoded = catalog_cache.listing(coding);
+        if (encoded.body) return encoded;
+    }
+    auto plain = catalog_cache.listing();
+    if (!plain.body || coding == ContentCoding::identity) return plain;
+    if (plain.body->size() < compression_options.min_bytes) {
+        coding = ContentCoding::identity;
+        return plain;
+    }
+    return {catalog_cache.store_list_body(plain.version, encode_body(coding, *plain.body), coding), plain.version};
+}
+
+// A front-end file, in the best coding the client accepts. Content-addressed names are cached
+// for a year; index.html and plain names are revalidated with their ETag.
+crow::response static_response(const crow::request& req, const std::string& name) {
+    bool immutable = false;
+    const StaticAsset* asset = static_assets.find(name, immutable);
+    if (!asset) return crow::response(404, "Not found");
+
+    std::array<bool, content_coding_count> offered = asset->offered();
+    if (!compression_enabled) offered = {true};
+    const ContentCoding coding = negotiate_coding(req.get_header_value("Accept-Encoding"), offered);
+    const size_t variants = static_cast<size_t>(std::count(offered.begin(), offered.end(), true));
+
+    const std::string etag = etag_for_coding(asset->etag, coding);
+    crow::response res(CatalogCache::matches(req.get_header_value("If-None-Match"), etag) ? 304 : 200);
+    if (res.code == 200) {
+        res.body = *asset->bodies[static_cast<size_t>(coding)];
+        res.set_header("Content-Type", asset->content_type);
+        if (coding != ContentCoding::identity) {
+            res.set_header("Content-Encoding", content_coding_names[static_cast<size_t>(coding)]);
+            compression_counters.record_response(coding);
+        }
+    }
+    res.set_header("ETag", etag);
+    res.set_header("Cache-Control", immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    if (variants > 1) res.set_header("Vary", "Accept-Encoding");
+    return res;
+}
+
+// Load the whole book table into the search index; search falls back to the repository if this fails
+void load_book_index() {
+    try {
+        auto session = storage->session();
+        std::vector<Book> books;
+        session->books().scan({}, [&](const Book& book) { books.push_back(book); });
+        book_index.rebuild(books);
+        std::cout << "Search index built over " << books.size() << " books." << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Search index build failed, searches will use the database: " << e.what() << std::endl;
+    }
+}
+
+// Largest page GET /api/books?limit= will return
+constexpr int max_page_size = 1000;
+
+// Rows per array-bound INSERT in POST /api/books/bulk; the upper bound keeps the key check's
+// IN list under SQL Server's 2100-parameter limit
+const size_t default_bulk_batch = env_or("LIBRARY_BULK_BATCH", 500);
+constexpr size_t max_bulk_batch = 2000;
+
+// Rows per chunk (and per transaction) of a catalog import
+const size_t default_import_batch = env_or("LIBRARY_IMPORT_BATCH", 1000);
+
+// Where exports are spooled before they are sent (LIBRARY_EXPORT_DIR, default the system temp directory)
+std::filesystem::path export_dir() {
+    const std::string dir = env_or("LIBRARY_EXPORT_DIR", std::string());
+    return dir.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(dir);
+}
+
+// Fills book from a POST body; false with a message when a required field is missing or mistyped
+bool parse_new_book(const crow::json::rvalue& body, Book& book, std::string& error) {
+    if (body.t() != crow::json::type::Object) {
+        error = "Expected a JSON object";
+        return false;
+    }
+    for (const char* field : {"book_id", "book_name", "book_isbn", "book_author", "book_publisher"}) {
+        if (!body.has(field)) {
+            error = "Missing required field: " + std::string(field);
+            return false;
+        }
+    }
+    try {
+        book.book_id = body["book_id"].s();
+        book.book_name = body["book_name"].s();
+        book.book_isbn = body["book_isbn"].s();
+        book.book_author = body["book_author"].s();
+        book.book_publisher = body["book_publisher"].s();
+        book.interview_times = body.has("interview_times") ? body["interview_times"].i() : 0;
+        book.book_price = body.has("book_price") ? body["book_price"].d() : 0.0;
+    } catch (const std::runtime_error&) {
+        error = "Field has the wrong JSON type";
+        return false;
+    }
+    return true;
+}
+
+// Sink that writes rows as comma-separated JSON objects straight into out, so a listing exists
+// once in memory (no per-row wvalue trees); bodies above Crow's stream threshold are written
+// to the socket in 16 KB slices.
+template <class Row>
+RowSink<Row> json_rows(std::string& out) {
+    return [&out, first = true](const Row& row) mutable {
+        PhaseTimer timer(RequestPhase::serialize);
+        if (!first) out.push_back(',');
+        first = false;
+        append_row_json(out, row);
+    };
+}
+
+// Counts the time sink spends on each row as serialization rather than database time
+template <class Row>
+RowSink<Row> serializing(const RowSink<Row>& sink) {
+    return [&sink](const Row& row) {
+        PhaseTimer timer(RequestPhase::serialize);
+        sink(row);
+    };
+}
+
+// String member of a JSON body, or "" when it is absent or null
+std::string json_string_or(const crow::json::rvalue& body, const char* key) {
+    if (!body.has(key) || body[key].t() == crow::json::type::Null) return {};
+    return body[key].s();
+}
+
+// Nullable column: absent, null and "" all store NULL
+std::optional<std::string> json_optional_string(const crow::json::rvalue& body, const char* key) {
+    std::string value = json_string_or(body, key);
+    if (value.empty()) return std::nullopt;
+    return value;
+}
+
+// Local date as YYYY-MM-DD
+std::string today() {
+    const std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char buffer[11];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &local);
+    return buffer;
+}
+
+// Operations one POST /api/batch may carry (LIBRARY_BATCH_MAX); they share one transaction
+const size_t max_batch_operations = env_or("LIBRARY_BATCH_MAX", 1000);
+
+// One entry of a POST /api/batch body: the row fields of the matching single-row request,
+// plus "op" (insert, update or delete) and "table" (books, readers or records)
+struct BatchOperation {
+    enum class Kind { insert, update, remove };
+    enum class Table { books, readers, records };
+
+    Kind kind = Kind::insert;
+    Table table = Table::books;
+    Book book;
+    Reader reader;
+    Record record;
+};
+
+// Fills op from a batch entry, with the same required fields and defaults as the single-row
+// routes; false with a message when the entry is malformed
+bool parse_batch_operation(const crow::json::rvalue& entry, BatchOperation& op, std::string& error) {
+    if (entry.t() != crow::json::type::Object) {
+        error = "Expected a JSON object";
+        return false;
+    }
+    const std::string kind = json_string_or(entry, "op");
+    const std::string table = json_string_or(entry, "table");
+    if (kind == "insert") {
+        op.kind = BatchOperation::Kind::insert;
+    } else if (kind == "update") {
+        op.kind = BatchOperation::Kind::update;
+    } else if (kind == "delete") {
+        op.kind = BatchOperation::Kind::remove;
+    } else {
+        error = "op must be insert, update or delete";
+        return false;
+    }
+    if (table == "books") {
+        op.table = BatchOperation::Table::books;
+    } else if (table == "readers") {
+        op.table = BatchOperation::Table::readers;
+    } else if (table == "records") {
+        op.table = BatchOperation::Table::records;
+    } else {
+        error = "table must be books, readers or records";
+        return false;
+    }
+
+    try {
+        switch (op.table) {
+        case BatchOperation::Table::books:
+            if (op.kind != BatchOperation::Kind::remove) return parse_new_book(entry, op.book, error);
+            op.book.book_id = json_string_or(entry, "book_id");
+            if (op.book.book_id.empty()) error = "Missing required field: book_id";
+            break;
+        case BatchOperation::Table::readers:
+            op.reader.reader_id = json_string_or(entry, "reader_id");
+            if (op.reader.reader_id.empty()) {
+                error = "Missing required field: reader_id";
+                break;
+            }
+            op.reader.reader_name = json_string_or(entry, "reader_name");
+            op.reader.reader_sex = json_string_or(entry, "reader_sex");
+            op.reader.reader_department = json_string_or(entry, "reader_department");
+            break;
+        case BatchOperation::Table::records:
+            for (const char* field : {"book_id", "reader_id"}) {
+                if (json_string_or(entry, field).empty()) {
+                    error = "Missing required field: " + std::string(field);
+                    return false;
+                }
+            }
+            op.record.book_id = entry["book_id"].s();
+            op.record.reader_id = entry["reader_id"].s();
+            op.record.borrow_date = json_string_or(entry, "borrow_date");
+            if (op.record.borrow_date.empty()) {
+                if (op.kind == BatchOperation::Kind::update) error = "Missing required field: borrow_date";
+                if (op.kind == BatchOperation::Kind::insert) op.record.borrow_date = today();
+            }
+            op.record.return_date = json_optional_string(entry, "return_date");
+            op.record.notes = json_optional_string(entry, "notes");
+            break;
+        }
+    } catch (const std::runtime_error&) {
+        error = "Field has the wrong JSON type";
+    }
+    return error.empty();
+}
+
+// Runs op in session; the HTTP status its single-row route would answer on success (201 or
+// 200), or 404 when the row to update or delete does not exist. SqlError propagates.
+int run_batch_operation(StorageSession& session, const BatchOperation& op) {
+    using Kind = BatchOperation::Kind;
+    bool found = true;
+    switch (op.table) {
+    case BatchOperation::Table::books:
+        if (op.kind == Kind::insert) session.books().insert(op.book);
+        if (op.kind == Kind::update) found = session.books().update(op.book);
+        if (op.kind == Kind::remove) found = session.books().remove(op.book.book_id);
+        break;
+    case BatchOperation::Table::readers:
+        if (op.kind == Kind::insert) session.readers().insert(op.reader);
+        if (op.kind == Kind::update) found = session.readers().update(op.reader);
+        if (op.kind == Kind::remove) found = session.readers().remove(op.reader.reader_id);
+        break;
+    case BatchOperation::Table::records:
+        if (op.kind == Kind::insert) session.records().insert(op.record);
+        if (op.kind == Kind::update) found = session.records().update(op.record);
+        if (op.kind == Kind::remove) found = session.records().remove(op.record.book_id, op.record.reader_id);
+        break;
+    }
+    if (!found) return 404;
+    return op.kind == Kind::insert ? 201 : 200;
+}
+
+// Why op failed with status (404 or 409), worded as its single-row route words it
+std::string batch_operation_error(const BatchOperation& op, int status) {
+    static const char* nouns[] = {"Book", "Reader", "Record"};
+    const char* noun = nouns[static_cast<size_t>(op.table)];
+    if (status == 404) {
+        return std::string(noun) + (op.kind == BatchOperation::Kind::update ? " to update not found" : " to delete not found");
+    }
+    switch (op.table) {
+    case BatchOperation::Table::books:
+        return "Book with ID " + op.book.book_id + " already exists.";
+    case BatchOperation::Table::readers:
+        return "Reader with ID " + op.reader.reader_id + " already exists.";
+    case BatchOperation::Table::records:
+        break;
+    }
+    return "Reader " + op.record.reader_id + " already has a record for book " + op.record.book_id + ".";
+}
+
+// What a batch did: the status of each operation that ran, in order. On a failure the last
+// one is the failure and the transaction was rolled back.
+struct BatchOutcome {
+    std::vector<int> statuses;
+    bool committed = false;
+};
+
+// Percent-encode everything outside the RFC 3986 unreserved set
+std::string url_encode(const std::string& value) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string encoded;
+    encoded.reserve(value.size());
+    for (unsigned char c : value) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded.push_back(static_cast<char>(c));
+        } else {
+            encoded.push_back('%');
+            encoded.push_back(hex[c >> 4]);
+            encoded.push_back(hex[c & 0xF]);
+        }
+    }
+    return encoded;
+}
+
+std::string trim(const std::string& value) {
+    const auto first = value.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return std::string();
+    const auto last = value.find_last_not_of(" \t\r\n");
+    return value.substr(first, last - first + 1);
+}
+
+// Unparseable prices are ignored rather than rejected, as the Python backend did
+std::optional<double> parse_price(const char* value) {
+    if (!value || !*value) return std::nullopt;
+    try {
+        return std::stod(value);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+void append_optional_string(std::string& out, const char* value) {
+    if (value && *value) {
+        append_json_string(out, value);
+    } else {
+        out.append("null");
+    }
+}
+
+void append_search_metadata(std::string& out, const crow::request& req, const BookSearchRequest& search,
+                            long long total, const std::vector<std::string>& steps) {
+    out.append(",\"total\":");
+    append_json_number(out, total);
+    out.push_back(',');
+    append_json_key(out, "keyword");
+    append_json_string(out, search.keyword);
+    out.push_back(',');
+    append_json_key(out, "search_by");
+    append_json_string(out, search.search_by);
+    out.push_back(',');
+    append_json_key(out, "min_price");
+    append_optional_string(out, req.url_params.get("min_price"));
+    out.push_back(',');
+    append_json_key(out, "max_price");
+    append_optional_string(out, req.url_params.get("max_price"));
+    out.push_back(',');
+    append_json_key(out, "plan");
+    out.push_back('[');
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (i) out.push_back(',');
+        append_json_string(out, steps[i]);
+    }
+    out.append("]}");
+}
+
+uint8_t search_fields(const std::string& search_by) {
+    if (search_by == "title") return field_name;
+    if (search_by == "author") return field_author;
+    if (search_by == "publisher") return field_publisher;
+    if (search_by == "isbn") return field_isbn;
+    return field_all;
+}
+
 int main() {
-    crow::App<CORSHandler> app;
-    app.loglevel(crow::LogLevel::Debug);
+    // Log lines go through per-thread ring buffers to a writer thread; LIBRARY_LOG_RING lines
+    // per thread, Info/Debug sampled to LIBRARY_LOG_SAMPLE_RATE a second (0 keeps them all)
+    if (env_or("LIBRARY_LOG_ASYNC", 1)) {
+        AsyncLogHandler::Options log_options;
+        log_options.ring_size = env_or("LIBRARY_LOG_RING", log_options.ring_size);
+        log_options.info_per_second = env_or("LIBRARY_LOG_SAMPLE_RATE", log_options.info_per_second);
+        async_log = std::make_unique<AsyncLogHandler>(log_options);
+        crow::logger::setHandler(async_log.get());
+    }
+
+    crow::App<RequestMetricsMiddleware, CORSHandler, CompressionMiddleware> app;
+    // LIBRARY_LOG_LEVEL: 0 Debug (default), 1 Info, 2 Warning, 3 Error, 4 Critical
+    app.loglevel(static_cast<crow::LogLevel>(std::min<size_t>(env_or("LIBRARY_LOG_LEVEL", 0), 4)));
 
     if (!initDatabase()) {
         return -1;
     }
+    // Database calls block, so SQL backends get their own threads for them: LIBRARY_DB_THREADS
+    // (default the pool size; more would only wait on the pool) and LIBRARY_DB_QUEUE jobs
+    // waiting for one (default 256) before requests are turned away with 503
+    if (db) {
+        ExecutorOptions executor;
+        executor.threads = env_or("LIBRARY_DB_THREADS", db->pool_stats().max_size);
+        executor.queue_limit = env_or("LIBRARY_DB_QUEUE", executor.queue_limit);
+        if (executor.threads > 0) db_executor = std::make_unique<DbExecutor>(executor);
+    }
+    if (env_or("LIBRARY_SEARCH_INDEX", 1)) {
+        load_book_index();
+    }
+    // Front end from LIBRARY_STATIC_DIR (default the source tree, where index.html lives)
+    try {
+        const std::string static_dir = env_or("LIBRARY_STATIC_DIR", std::string(LIBRARY_DEFAULT_STATIC_DIR));
+        const size_t files = static_assets.load(static_dir, compression_options);
+        std::cout << "Serving " << files << " front-end files from " << static_dir << "." << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Front-end files not loaded, only the API is served: " << e.what() << std::endl;
+    }
+
+    // The front end, on the same origin as the API
+    CROW_ROUTE(app, "/").methods("GET"_method)([](const crow::request& req) { return static_response(req, "index.html"); });
+    CROW_ROUTE(app, "/index.html").methods("GET"_method)([](const crow::request& req) { return static_response(req, "index.html"); });
+    CROW_ROUTE(app, "/static/<string>").methods("GET"_method)([](const crow::request& req, const std::string& name) {
+        return static_response(req, name);
+    });
 
-    // Get all books
-    CROW_ROUTE(app, "/api/books").methods("GET"_method)([]() {
+    // Get all books, or one page of them when ?limit= is given. The full listing is not constant
+    // memory: it is built as one string and cached whole (plus a compressed copy per coding), so
+    // large catalogs should be read in pages or through /api/export/books
+    CROW_ROUTE(app, "/api/books").methods("GET"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
         CROW_LOG_INFO << "Received request for GET /api/books";
         try {
-            auto conn = db_pool->get_connection();
-            if (!conn || !conn->connected()) {
-                CROW_LOG_ERROR << "Failed to get a valid database connection from pool.";
-                return crow::response(500, "Failed to get database connection.");
+            // Conditional GET: the ETag only changes when a write bumps the catalog version,
+            // so a poll that already has the current listing is answered without the database.
+            const std::string query = query_string(req);
+            const ContentCoding coding = response_coding(req);
+            uint64_t version = catalog_cache.version();
+            if (CatalogCache::matches(req.get_header_value("If-None-Match"), etag_for_coding(catalog_cache.etag(version, query), coding))) {
+                catalog_cache.record_not_modified();
+                co_return not_modified_response(catalog_cache.etag(version, query), coding);
             }
 
-            auto result = nanodbc::execute(*conn, NANODBC_TEXT("SELECT book_id, book_name, book_isbn, book_author, book_publisher, interview_times, book_price FROM book"));
-
-            std::vector<crow::json::wvalue> booksArray;
-            long long count = 0;
-            while (result.next()) {
-                count++;
-                crow::json::wvalue book;
-                
-                nanodbc::string book_id_w = result.get<nanodbc::string>(0);
-                book["book_id"] = wstring_to_utf8(book_id_w);
-
-                nanodbc::string book_name_w = result.get<nanodbc::string>(1);
-                book["book_name"] = wstring_to_utf8(book_name_w);
-
-                nanodbc::string book_isbn_w = result.get<nanodbc::string>(2);
-                book["book_isbn"] = wstring_to_utf8(book_isbn_w);
+            // The full listing is cached already compressed; body_coding drops to identity when
+            // it is too small to compress
+            const char* limit_param = req.url_params.get("limit");
+            ContentCoding body_coding = coding;
+            if (!limit_param) {
+                auto cached = cached_listing(body_coding);
+                if (cached.body) {
+                    catalog_cache.record_hit();
+                    crow::response res(*cached.body);
+                    res.set_header("Content-Type", "application/json");
+                    set_catalog_cache_headers(res, catalog_cache.etag(cached.version, query), coding);
+                    set_content_coding(res, body_coding);
+                    co_return res;
+                }
+            }
+            catalog_cache.record_miss();
 
-                nanodbc::string book_author_w = result.get<nanodbc::string>(3);
-                book["book_author"] = wstring_to_utf8(book_author_w);
+            crow::response res;
+            std::string& out = res.body;
+            out.reserve(64 * 1024);
+            out.append("{\"data\":[");
 
-                nanodbc::string book_publisher_w = result.get<nanodbc::string>(4);
-                book["book_publisher"] = wstring_to_utf8(book_publisher_w);
+            long long count = 0;
+            if (!limit_param) {
+                // Named: GCC 12 miscompiles an aggregate temporary ({}) passed inside a co_await
+                // expression, and frees the copy's string from the caller's frame
+                const BookScan everything;
+                count = co_await async_db().books().scan(everything, json_rows<Book>(out));
+            } else {
+                // Paged listing: keyset (?after=<book_id>) is an index range scan on the primary key;
+                // ?offset= is kept for random page jumps but gets slower the deeper it goes.
+                BookScan scan;
+                long long offset = -1;
+                try {
+                    scan.limit = std::stoi(limit_param);
+                    if (const char* offset_param = req.url_params.get("offset")) offset = std::stoll(offset_param);
+                } catch (const std::exception&) {
+                    co_return crow::response(400, "limit and offset must be integers");
+                }
+                if (scan.limit < 1 || scan.limit > max_page_size || (req.url_params.get("offset") && offset < 0)) {
+                    co_return crow::response(400, "limit must be between 1 and " + std::to_string(max_page_size) + " and offset must not be negative");
+                }
+                if (offset > 0) {
+                    scan.offset = offset;
+                } else if (offset < 0) {
+                    if (const char* after_param = req.url_params.get("after")) scan.after = after_param;
+                }
 
-                book["interview_times"] = result.get<int>(5, 0);
-                book["book_price"] = result.get<double>(6, 0.0);
-                booksArray.push_back(std::move(book));
+                // The page and the total in one trip to the executor, on one session
+                std::string last_book_id;
+                long long total = 0;
+                count = co_await async_db().run([&](StorageSession& session) {
+                    auto write_row = json_rows<Book>(out);
+                    const long long rows = session.books().scan(scan, [&](const Book& book) {
+                        write_row(book);
+                        last_book_id = book.book_id;
+                    });
+                    total = session.books().count();
+                    return rows;
+                });
+                if (count == scan.limit) {
+                    res.set_header("X-Next-After", url_encode(last_book_id));
+                }
+                res.set_header("X-Total-Count", std::to_string(total));
             }
+            out.append("]}");
             CROW_LOG_INFO << "Found " << count << " books in the database.";
 
-            db_pool->return_connection(std::move(conn));
-            crow::json::wvalue response;
-            response["data"] = std::move(booksArray);
-            return crow::response(response);
-        } catch (const nanodbc::database_error& e) {
+            // Stored under the version read before the query; dropped if a write landed meanwhile
+            if (!limit_param) {
+                if (body_coding != ContentCoding::identity && out.size() >= compression_options.min_bytes) {
+                    // The identity copy moves into the cache; only the compressed one is sent
+                    std::string compressed = encode_body(body_coding, out);
+                    catalog_cache.store_list_body(version, std::move(out));
+                    res.body = *catalog_cache.store_list_body(version, std::move(compressed), body_coding);
+                    set_content_coding(res, body_coding);
+                } else {
+                    catalog_cache.store_list_body(version, out);
+                }
+            } else {
+                encode_catalog_body(req, res, coding);
+            }
+
+            res.set_header("Content-Type", "application/json");
+            set_catalog_cache_headers(res, catalog_cache.etag(version, query), coding);
+            co_return res;
+        } catch (const PoolExhaustedError& e) {
+            CROW_LOG_WARNING << "Connection pool exhausted for GET /api/books: " << e.what();
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
             CROW_LOG_ERROR << "Database query failed for GET /api/books: " << e.what();
-            return crow::response(500, "Database query failed: " + std::string(e.what()));
+            co_return crow::response(500, "Database query failed: " + std::string(e.what()));
+        } catch (const DbQueueFullError&) {
+            throw;  // co_route answers 503
         } catch (const std::exception& e) {
             CROW_LOG_ERROR << "An unexpected error occurred in GET /api/books: " << e.what();
-            return crow::response(500, "An unexpected error occurred: " + std::string(e.what()));
+            co_return crow::response(500, "An unexpected error occurred: " + std::string(e.what()));
         }
-    });
+    }));
 
-    // Add a new book
-    CROW_ROUTE(app, "/api/books").methods("POST"_method)([](const crow::request& req) {
-        auto body = crow::json::load(req.body);
-        if (!body) return crow::response(400, "Invalid request body");
+    // Advanced search; see book_search.h for how each filter is planned
+    CROW_ROUTE(app, "/api/books/search").methods("GET"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
+        BookSearchRequest search;
+        if (const char* keyword = req.url_params.get("keyword")) search.keyword = trim(keyword);
+        if (const char* search_by = req.url_params.get("search_by")) search.search_by = search_by;
+        if (const char* match = req.url_params.get("match")) search.match = match;
+        search.min_price = parse_price(req.url_params.get("min_price"));
+        search.max_price = parse_price(req.url_params.get("max_price"));
 
-        // Field validation
-        const std::vector<std::string> required_fields = {"book_id", "book_name", "book_isbn", "book_author", "book_publisher"};
-        for (const auto& field : required_fields) {
-            if (!body.has(field)) {
-                return crow::response(400, "Missing required field: " + field);
+        // Keyword searches are answered from the in-memory index when it gives the same rows:
+        // prefix searches, and contains searches it can match as a substring. Exact matches,
+        // other contains searches and price-only filters go to the repository (the SQL planner
+        // for the SQL backends)
+        const bool prefix = search.match == "prefix" || (!search.keyword.empty() && search.keyword.back() == '*');
+        if (book_index.ready() && !search.keyword.empty() && search.match != "exact" &&
+            (prefix || book_index.answers_substring(search.keyword))) {
+            const auto hits = book_index.search(search.keyword, search_fields(search.search_by), search.min_price, search.max_price);
+            crow::response res;
+            std::string& out = res.body;
+            out.append("{\"data\":[");
+            for (size_t i = 0; i < hits.size(); ++i) {
+                if (i) out.push_back(',');
+                append_row_json(out, hits[i].book);
             }
+            out.push_back(']');
+            append_search_metadata(out, req, search, static_cast<long long>(hits.size()), {"inverted_index"});
+            res.set_header("Content-Type", "application/json");
+            co_return res;
         }
 
         try {
-            auto conn = db_pool->get_connection();
-            nanodbc::statement stmt(*conn);
-            nanodbc::prepare(stmt, NANODBC_TEXT("INSERT INTO book (book_id, book_name, book_isbn, book_author, book_publisher, interview_times, book_price) VALUES (?, ?, ?, ?, ?, ?, ?)"));
-
-            const auto book_id = utf8_to_wstring(body["book_id"].s());
-            const auto book_name = utf8_to_wstring(body["book_name"].s());
-            const auto book_isbn = utf8_to_wstring(body["book_isbn"].s());
-            const auto book_author = utf8_to_wstring(body["book_author"].s());
-            const auto book_publisher = utf8_to_wstring(body["book_publisher"].s());
-            int interview_times = body.has("interview_times") ? body["interview_times"].i() : 0;
-            double book_price = body.has("book_price") ? body["book_price"].d() : 0.0;
-
-            stmt.bind(0, book_id.c_str());
-            stmt.bind(1, book_name.c_str());
-            stmt.bind(2, book_isbn.c_str());
-            stmt.bind(3, book_author.c_str());
-            stmt.bind(4, book_publisher.c_str());
-            stmt.bind(5, &interview_times);
-            stmt.bind(6, &book_price);
-
-            nanodbc::execute(stmt);
-            
-            db_pool->return_connection(std::move(conn));
-            
+            crow::response res;
+            std::string& out = res.body;
+            out.append("{\"data\":[");
+            std::vector<std::string> plan;
+            const long long total = co_await async_db().books().search(search, json_rows<Book>(out), plan);
+            out.push_back(']');
+            append_search_metadata(out, req, search, total, plan);
+
+            CROW_LOG_INFO << "Book search matched " << total << " rows via " << plan.size() << " predicate(s)";
+            res.set_header("Content-Type", "application/json");
+            co_return res;
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            CROW_LOG_ERROR << "Database search failed: " << e.what();
+            co_return crow::response(500, "Database search failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Get one book; served from the catalog cache when the row has been read since the last write to it
+    CROW_ROUTE(app, "/api/books/<string>").methods("GET"_method)(co_route<std::string>([](const crow::request& req, std::string book_id_str) -> asio::awaitable<crow::response> {
+        try {
+            const ContentCoding coding = response_coding(req);
+            const uint64_t version = catalog_cache.version();
+            const std::string etag = catalog_cache.etag(version, "book:" + book_id_str);
+            if (CatalogCache::matches(req.get_header_value("If-None-Match"), etag_for_coding(etag, coding))) {
+                catalog_cache.record_not_modified();
+                co_return not_modified_response(etag, coding);
+            }
+
+            std::optional<Book> book = catalog_cache.find_book(book_id_str);
+            if (book) {
+                catalog_cache.record_hit();
+            } else {
+                catalog_cache.record_miss();
+                book = co_await async_db().books().find(book_id_str);
+                if (!book) {
+                    co_return crow::response(404, "Book not found");
+                }
+                catalog_cache.store_book(version, *book);
+            }
+
+            crow::response res;
+            append_row_json(res.body, *book);
+            encode_catalog_body(req, res, coding);
+            res.set_header("Content-Type", "application/json");
+            set_catalog_cache_headers(res, etag, coding);
+            co_return res;
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database query failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Add a new book
+    CROW_ROUTE(app, "/api/books").methods("POST"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body) co_return crow::response(400, "Invalid request body");
+
+        Book book;
+        std::string error;
+        if (!parse_new_book(body, book, error)) co_return crow::response(400, error);
+
+        try {
+            co_await async_db().run([&book](StorageSession& session) {
+                std::lock_guard<std::mutex> ordered(book_index.write_mutex());
+                session.books().insert(book);
+                book_index.upsert(book);
+            });
+            catalog_cache.on_write(book.book_id);
+
             crow::json::wvalue result;
             result["message"] = "Book added successfully";
-            result["book_id"] = body["book_id"].s();
-            return crow::response(201, result);
-        } catch (const nanodbc::database_error& e) {
-            return crow::response(500, "Database insert failed: " + std::string(e.what()));
+            result["book_id"] = book.book_id;
+            co_return crow::response(201, result);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            if (e.constraint_violation()) {
+                co_return crow::response(409, "Book with ID " + book.book_id + " already exists.");
+            }
+            co_return crow::response(500, "Database insert failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Add a JSON array of books in one transaction, batch_size rows per array-bound INSERT
+    // (?batch_size=, default LIBRARY_BULK_BATCH). Invalid rows and taken book_ids are reported
+    // by array index and do not stop the other rows; any other failure rolls back everything.
+    CROW_ROUTE(app, "/api/books/bulk").methods("POST"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body || body.t() != crow::json::type::List) co_return crow::response(400, "Request body must be a JSON array of books");
+
+        size_t batch_size = default_bulk_batch;
+        if (const char* batch_param = req.url_params.get("batch_size")) {
+            try {
+                batch_size = std::stoul(batch_param);
+            } catch (const std::exception&) {
+                batch_size = 0;
+            }
+            if (batch_size < 1 || batch_size > max_bulk_batch) {
+                co_return crow::response(400, "batch_size must be between 1 and " + std::to_string(max_bulk_batch));
+            }
+        }
+
+        std::vector<Book> books;
+        std::vector<size_t> positions;  // Array index of every entry in books
+        std::vector<std::pair<size_t, std::string>> errors;
+        books.reserve(body.size());
+        positions.reserve(body.size());
+        for (size_t i = 0; i < body.size(); ++i) {
+            Book book;
+            std::string error;
+            if (!parse_new_book(body[i], book, error)) {
+                errors.emplace_back(i, std::move(error));
+                continue;
+            }
+            books.push_back(std::move(book));
+            positions.push_back(i);
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        BulkInsertResult result;
+        try {
+            result = co_await async_db().run([&books, batch_size](StorageSession& session) {
+                std::lock_guard<std::mutex> ordered(book_index.write_mutex());
+                session.begin();
+                BulkInsertResult inserted = session.books().insert_many(books, batch_size);
+                session.commit();
+                std::vector<bool> skipped(books.size());
+                for (size_t index : inserted.duplicates) skipped[index] = true;
+                for (size_t i = 0; i < books.size(); ++i) {
+                    if (!skipped[i]) book_index.upsert(books[i]);
+                }
+                return inserted;
+            });
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Bulk insert failed, no rows were added: " + std::string(e.what()));
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        for (size_t index : result.duplicates) {
+            errors.emplace_back(positions[index], "Book with ID " + books[index].book_id + " already exists.");
+        }
+        if (result.inserted > 0) catalog_cache.invalidate();
+        std::sort(errors.begin(), errors.end());
+
+        crow::json::wvalue json;
+        json["inserted"] = result.inserted;
+        json["failed"] = errors.size();
+        json["batch_size"] = batch_size;
+        json["elapsed_ms"] = seconds * 1000.0;
+        json["rows_per_sec"] = seconds > 0 ? static_cast<double>(result.inserted) / seconds : 0.0;
+        std::vector<crow::json::wvalue> error_list;
+        error_list.reserve(errors.size());
+        for (auto& [index, message] : errors) {
+            crow::json::wvalue entry;
+            entry["index"] = index;
+            entry["error"] = std::move(message);
+            error_list.push_back(std::move(entry));
+        }
+        json["errors"] = std::move(error_list);
+
+        CROW_LOG_INFO << "Bulk insert added " << result.inserted << " of " << body.size() << " books in " << seconds * 1000.0 << " ms";
+        co_return crow::response(200, json);
+    }));
+
+    // Run a JSON array of insert/update/delete operations on books, readers and records, in
+    // order, in one transaction on one pooled connection; repeated statements come from that
+    // connection's prepared-statement cache. All or nothing: any invalid entry answers 400
+    // before anything runs, and the first operation that fails (404 or 409) rolls back the lot
+    // and becomes the response status. results holds the status of every operation that ran.
+    CROW_ROUTE(app, "/api/batch").methods("POST"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body || body.t() != crow::json::type::List) co_return crow::response(400, "Request body must be a JSON array of operations");
+        if (body.size() > max_batch_operations) {
+            co_return crow::response(413, "A batch may hold at most " + std::to_string(max_batch_operations) + " operations");
+        }
+
+        std::vector<BatchOperation> ops(body.size());
+        std::vector<crow::json::wvalue> error_list;
+        for (size_t i = 0; i < body.size(); ++i) {
+            std::string error;
+            if (parse_batch_operation(body[i], ops[i], error)) continue;
+            crow::json::wvalue entry;
+            entry["index"] = i;
+            entry["error"] = std::move(error);
+            error_list.push_back(std::move(entry));
         }
+        if (!error_list.empty()) {
+            crow::json::wvalue json;
+            json["committed"] = false;
+            json["errors"] = std::move(error_list);
+            co_return crow::response(400, json);
+        }
+
+        BatchOutcome outcome;
+        try {
+            if (!ops.empty()) {
+                outcome = co_await async_db().run([&ops](StorageSession& session) {
+                    BatchOutcome done;
+                    done.statuses.reserve(ops.size());
+                    std::lock_guard<std::mutex> ordered(book_index.write_mutex());
+                    session.begin();
+                    for (const auto& op : ops) {
+                        int status;
+                        try {
+                            status = run_batch_operation(session, op);
+                        } catch (const SqlError& e) {
+                            if (!e.constraint_violation()) throw;
+                            status = 409;
+                        }
+                        done.statuses.push_back(status);
+                        if (status >= 400) {
+                            session.rollback();
+                            return done;
+                        }
+                    }
+                    session.commit();
+                    done.committed = true;
+                    for (const auto& op : ops) {
+                        if (op.table != BatchOperation::Table::books) continue;
+                        if (op.kind == BatchOperation::Kind::remove) {
+                            book_index.remove(op.book.book_id);
+                        } else {
+                            book_index.upsert(op.book);
+                        }
+                    }
+                    return done;
+                });
+            } else {
+                outcome.committed = true;
+            }
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Batch failed, nothing was changed: " + std::string(e.what()));
+        }
+
+        if (outcome.committed) {
+            for (const auto& op : ops) {
+                if (op.table == BatchOperation::Table::books) catalog_cache.on_write(op.book.book_id);
+            }
+        }
+
+        crow::json::wvalue json;
+        json["committed"] = outcome.committed;
+        std::vector<crow::json::wvalue> results;
+        results.reserve(outcome.statuses.size());
+        for (size_t i = 0; i < outcome.statuses.size(); ++i) {
+            crow::json::wvalue entry;
+            entry["index"] = i;
+            entry["status"] = outcome.statuses[i];
+            if (outcome.statuses[i] >= 400) entry["error"] = batch_operation_error(ops[i], outcome.statuses[i]);
+            results.push_back(std::move(entry));
+        }
+        json["results"] = std::move(results);
+        co_return crow::response(outcome.committed ? 200 : outcome.statuses.back(), json);
+    }));
+
+    // Import a CSV (with a header row) or NDJSON catalog in the background. The import takes
+    // over the request body; poll the returned status URL for progress.
+    // ?format=csv|ndjson (default from Content-Type), ?charset=utf-8|latin1, ?batch_size=
+    CROW_ROUTE(app, "/api/imports").methods("POST"_method)([](const crow::request& req) {
+        ImportOptions options;
+        const char* format = req.url_params.get("format");
+        const std::string content_type = req.get_header_value("Content-Type");
+        if (format ? std::string(format) == "ndjson" : content_type.find("ndjson") != std::string::npos) {
+            options.format = ImportFormat::ndjson;
+        } else if (format && std::string(format) != "csv") {
+            return crow::response(400, "format must be csv or ndjson");
+        }
+        if (const char* charset = req.url_params.get("charset")) {
+            const std::string name = charset;
+            if (name == "latin1" || name == "iso-8859-1") {
+                options.charset = ImportCharset::latin1;
+            } else if (name != "utf-8" && name != "utf8") {
+                return crow::response(400, "charset must be utf-8 or latin1");
+            }
+        }
+        options.batch_size = default_import_batch;
+        if (const char* batch_param = req.url_params.get("batch_size")) {
+            try {
+                options.batch_size = std::stoul(batch_param);
+            } catch (const std::exception&) {
+                options.batch_size = 0;
+            }
+            if (options.batch_size < 1 || options.batch_size > max_bulk_batch) {
+                return crow::response(400, "batch_size must be between 1 and " + std::to_string(max_bulk_batch));
+            }
+        }
+
+        std::shared_ptr<CatalogImport> job;
+        try {
+            // Crow only hands out const requests, but nothing reads the body after the handler
+            // (CORSHandler looks at the method and headers), so move it rather than copy a whole catalog
+            options.write_mutex = &book_index.write_mutex();
+            job = imports.start(std::move(const_cast<crow::request&>(req).body), options, *storage, [](const std::vector<Book>& inserted) {
+                book_index.upsert_many(inserted);
+                catalog_cache.invalidate();
+            });
+        } catch (const std::invalid_argument& e) {
+            return crow::response(400, e.what());
+        }
+        if (!job) {
+            crow::response res(429, "Another import is still running");
+            res.set_header("Retry-After", "5");
+            return res;
+        }
+
+        const std::string location = "/api/imports/" + std::to_string(job->id());
+        CROW_LOG_INFO << "Started catalog import " << job->id();
+        crow::response res(202, import_progress_json(job->progress()));
+        res.set_header("Location", location);
+        return res;
+    });
+
+    // Progress of every import still remembered
+    CROW_ROUTE(app, "/api/imports").methods("GET"_method)([]() {
+        std::vector<crow::json::wvalue> list;
+        for (const auto& job : imports.list()) list.push_back(import_progress_json(job->progress()));
+        crow::json::wvalue json;
+        json["data"] = std::move(list);
+        return crow::response(json);
+    });
+
+    CROW_ROUTE(app, "/api/imports/<uint>").methods("GET"_method)([](uint64_t id) {
+        auto job = imports.find(id);
+        if (!job) return crow::response(404, "Import not found");
+        return crow::response(import_progress_json(job->progress()));
     });
 
     // Edit a book
-    CROW_ROUTE(app, "/api/books/<string>").methods("PUT"_method)([](const crow::request& req, std::string book_id_str) {
+    CROW_ROUTE(app, "/api/books/<string>").methods("PUT"_method)(co_route<std::string>([](const crow::request& req, std::string book_id_str) -> asio::awaitable<crow::response> {
         auto body = crow::json::load(req.body);
-        if (!body) return crow::response(400, "Invalid request body");
+        if (!body) co_return crow::response(400, "Invalid request body");
 
         try {
-            auto conn = db_pool->get_connection();
-            nanodbc::statement stmt(*conn);
-            nanodbc::prepare(stmt, NANODBC_TEXT("UPDATE book SET book_name=?, book_isbn=?, book_author=?, book_publisher=?, interview_times=?, book_price=? WHERE book_id=?"));
-
-            const auto book_name = body["book_name"].s();
-            const auto book_isbn = body["book_isbn"].s();
-            const auto book_author = body["book_author"].s();
-            const auto book_publisher = body["book_publisher"].s();
-            int interview_times = body["interview_times"].i();
-            double book_price = body["book_price"].d();
-            const auto book_id = book_id_str;
-
-            stmt.bind(0, book_name);
-            stmt.bind(1, book_isbn);
-            stmt.bind(2, book_author);
-            stmt.bind(3, book_publisher);
-            stmt.bind(4, &interview_times);
-            stmt.bind(5, &book_price);
-            stmt.bind(6, book_id);
-
-            auto result = nanodbc::execute(stmt);
-
-            db_pool->return_connection(std::move(conn));
-
-            if (result.affected_rows() == 0) {
-                return crow::response(404, "Book to update not found");
+            Book book;
+            book.book_id = book_id_str;
+            book.book_name = body["book_name"].s();
+            book.book_isbn = body["book_isbn"].s();
+            book.book_author = body["book_author"].s();
+            book.book_publisher = body["book_publisher"].s();
+            book.interview_times = body.has("interview_times") ? body["interview_times"].i() : 0;
+            book.book_price = body.has("book_price") ? body["book_price"].d() : 0.0;
+
+            const bool updated = co_await async_db().run([&book](StorageSession& session) {
+                std::lock_guard<std::mutex> ordered(book_index.write_mutex());
+                if (!session.books().update(book)) return false;
+                book_index.upsert(book);
+                return true;
+            });
+            if (!updated) {
+                co_return crow::response(404, "Book to update not found");
             }
+            catalog_cache.on_write(book_id_str);
 
             crow::json::wvalue response_body;
             response_body["message"] = "Book updated successfully";
-            return crow::response(200, response_body);
-        } catch (const nanodbc::database_error& e) {
-            return crow::response(500, "Database update failed: " + std::string(e.what()));
+            co_return crow::response(200, response_body);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database update failed: " + std::string(e.what()));
         }
-    });
+    }));
 
     // Delete a book
-    CROW_ROUTE(app, "/api/books/<string>").methods("DELETE"_method)([](std::string book_id_str) {
+    CROW_ROUTE(app, "/api/books/<string>").methods("DELETE"_method)(co_route<std::string>([](std::string book_id_str) -> asio::awaitable<crow::response> {
+        try {
+            const bool removed = co_await async_db().run([&book_id_str](StorageSession& session) {
+                std::lock_guard<std::mutex> ordered(book_index.write_mutex());
+                if (!session.books().remove(book_id_str)) return false;
+                book_index.remove(book_id_str);
+                return true;
+            });
+            if (!removed) {
+                co_return crow::response(404, "Book to delete not found");
+            }
+            catalog_cache.on_write(book_id_str);
+
+            crow::json::wvalue response_body;
+            response_body["message"] = "Book deleted successfully";
+            co_return crow::response(200, response_body);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database delete failed: " + std::string(e.what()));
+        }
+    }));
+
+    // List readers
+    CROW_ROUTE(app, "/api/readers").methods("GET"_method)(co_route([]() -> asio::awaitable<crow::response> {
         try {
-            auto conn = db_pool->get_connection();
-            nanodbc::statement stmt(*conn);
-            nanodbc::prepare(stmt, NANODBC_TEXT("DELETE FROM book WHERE book_id = ?"));
-            
-            const auto book_id = book_id_str;
-            stmt.bind(0, book_id);
+            crow::response res;
+            std::string& out = res.body;
+            out.append("{\"data\":[");
+            co_await async_db().readers().scan(json_rows<Reader>(out));
+            out.append("]}");
+            res.set_header("Content-Type", "application/json");
+            co_return res;
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database query failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Add a reader
+    CROW_ROUTE(app, "/api/readers").methods("POST"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body) co_return crow::response(400, "Invalid request body");
+        if (!body.has("reader_id")) co_return crow::response(400, "Missing required field: reader_id");
+
+        Reader reader;
+        reader.reader_id = body["reader_id"].s();
+        reader.reader_name = json_string_or(body, "reader_name");
+        reader.reader_sex = json_string_or(body, "reader_sex");
+        reader.reader_department = json_string_or(body, "reader_department");
+
+        try {
+            co_await async_db().readers().insert(reader);
+
+            crow::json::wvalue result;
+            result["message"] = "Reader added successfully";
+            result["reader_id"] = reader.reader_id;
+            co_return crow::response(201, result);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            if (e.constraint_violation()) {
+                co_return crow::response(409, "Reader with ID " + reader.reader_id + " already exists.");
+            }
+            co_return crow::response(500, "Database insert failed: " + std::string(e.what()));
+        }
+    }));
 
-            auto result = nanodbc::execute(stmt);
+    // Edit a reader
+    CROW_ROUTE(app, "/api/readers/<string>").methods("PUT"_method)(co_route<std::string>([](const crow::request& req, std::string reader_id) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body) co_return crow::response(400, "Invalid request body");
 
-            db_pool->return_connection(std::move(conn));
+        Reader reader;
+        reader.reader_id = reader_id;
+        reader.reader_name = json_string_or(body, "reader_name");
+        reader.reader_sex = json_string_or(body, "reader_sex");
+        reader.reader_department = json_string_or(body, "reader_department");
 
-            if (result.affected_rows() == 0) {
-                return crow::response(404, "Book to delete not found");
+        try {
+            if (!co_await async_db().readers().update(reader)) {
+                co_return crow::response(404, "Reader to update not found");
             }
+            crow::json::wvalue response_body;
+            response_body["message"] = "Reader updated successfully";
+            co_return crow::response(200, response_body);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database update failed: " + std::string(e.what()));
+        }
+    }));
 
+    // Delete a reader
+    CROW_ROUTE(app, "/api/readers/<string>").methods("DELETE"_method)(co_route<std::string>([](std::string reader_id) -> asio::awaitable<crow::response> {
+        try {
+            if (!co_await async_db().readers().remove(reader_id)) {
+                co_return crow::response(404, "Reader to delete not found");
+            }
             crow::json::wvalue response_body;
-            response_body["message"] = "Book deleted successfully";
-            return crow::response(200, response_body);
-        } catch (const nanodbc::database_error& e) {
-            return crow::response(500, "Database delete failed: " + std::string(e.what()));
+            response_body["message"] = "Reader deleted successfully";
+            co_return crow::response(200, response_body);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database delete failed: " + std::string(e.what()));
+        }
+    }));
+
+    // List borrow records; record_id is a per-response handle the frontend uses to find a row
+    // again, the real key is (book_id, reader_id)
+    CROW_ROUTE(app, "/api/records").methods("GET"_method)(co_route([]() -> asio::awaitable<crow::response> {
+        try {
+            crow::response res;
+            std::string& out = res.body;
+            out.append("{\"data\":[");
+            long long index = 0;
+            co_await async_db().records().scan([&](const Record& record) {
+                if (index > 0) out.push_back(',');
+                out.append("{\"record_id\":\"temp_");
+                out.append(std::to_string(index++));
+                out.append("\",");
+                append_row_fields(out, record);
+                out.push_back('}');
+            });
+            out.append("]}");
+            res.set_header("Content-Type", "application/json");
+            co_return res;
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database query failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Add a borrow record; borrow_date defaults to today
+    CROW_ROUTE(app, "/api/records").methods("POST"_method)(co_route([](const crow::request& req) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body) co_return crow::response(400, "Invalid request body");
+        for (const char* field : {"book_id", "reader_id"}) {
+            if (!body.has(field)) co_return crow::response(400, "Missing required field: " + std::string(field));
+        }
+
+        Record record;
+        record.book_id = body["book_id"].s();
+        record.reader_id = body["reader_id"].s();
+        record.borrow_date = json_string_or(body, "borrow_date");
+        if (record.borrow_date.empty()) record.borrow_date = today();
+        record.return_date = json_optional_string(body, "return_date");
+        record.notes = json_optional_string(body, "notes");
+
+        try {
+            co_await async_db().records().insert(record);
+
+            crow::json::wvalue result;
+            result["message"] = "Record added successfully";
+            co_return crow::response(201, result);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            if (e.constraint_violation()) {
+                co_return crow::response(409, "Reader " + record.reader_id + " already has a record for book " + record.book_id + ".");
+            }
+            co_return crow::response(500, "Database insert failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Edit a borrow record
+    CROW_ROUTE(app, "/api/records/<string>/<string>").methods("PUT"_method)(co_route<std::string, std::string>([](const crow::request& req, std::string book_id, std::string reader_id) -> asio::awaitable<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body) co_return crow::response(400, "Invalid request body");
+
+        Record record;
+        record.book_id = book_id;
+        record.reader_id = reader_id;
+        record.borrow_date = json_string_or(body, "borrow_date");
+        if (record.borrow_date.empty()) co_return crow::response(400, "Missing required field: borrow_date");
+        record.return_date = json_optional_string(body, "return_date");
+        record.notes = json_optional_string(body, "notes");
+
+        try {
+            if (!co_await async_db().records().update(record)) {
+                co_return crow::response(404, "Record to update not found");
+            }
+            crow::json::wvalue response_body;
+            response_body["message"] = "Record updated successfully";
+            co_return crow::response(200, response_body);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database update failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Delete a borrow record
+    CROW_ROUTE(app, "/api/records/<string>/<string>").methods("DELETE"_method)(co_route<std::string, std::string>([](std::string book_id, std::string reader_id) -> asio::awaitable<crow::response> {
+        try {
+            if (!co_await async_db().records().remove(book_id, reader_id)) {
+                co_return crow::response(404, "Record to delete not found");
+            }
+            crow::json::wvalue response_body;
+            response_body["message"] = "Record deleted successfully";
+            co_return crow::response(200, response_body);
+        } catch (const PoolExhaustedError& e) {
+            co_return pool_exhausted_response(e);
+        } catch (const SqlError& e) {
+            co_return crow::response(500, "Database delete failed: " + std::string(e.what()));
+        }
+    }));
+
+    // Whole-table export: /api/export/books|readers|records?format=ndjson|csv|columnar.
+    // zstd-compressed when the client accepts it (or ?compress=zstd) and the server was built
+    // with zstd. See export.h for the columnar layout and why the body is spooled.
+    CROW_ROUTE(app, "/api/export/<string>").methods("GET"_method)([](const crow::request& req, crow::response& res, std::string table) {
+        const auto fail = [&](int code, std::string message) {
+            res = crow::response(code, std::move(message));
+            res.end();
+        };
+
+        ExportFormat format = ExportFormat::ndjson;
+        std::string content_type = "application/x-ndjson";
+        const std::string format_param = req.url_params.get("format") ? req.url_params.get("format") : "ndjson";
+        if (format_param == "csv") {
+            format = ExportFormat::csv;
+            content_type = "text/csv; charset=utf-8";
+        } else if (format_param == "columnar") {
+            format = ExportFormat::columnar;
+            content_type = "application/octet-stream";
+        } else if (format_param != "ndjson") {
+            return fail(400, "format must be ndjson, csv or columnar");
+        }
+        if (table != "books" && table != "readers" && table != "records") {
+            return fail(404, "Unknown table: " + table);
+        }
+
+        // zstd when the client's Accept-Encoding prefers it to identity (q-values honoured) and
+        // this build has it
+        std::array<bool, content_coding_count> offered{};
+        offered[static_cast<size_t>(ContentCoding::identity)] = true;
+        offered[static_cast<size_t>(ContentCoding::zstd)] = coding_available(ContentCoding::zstd);
+        bool zstd = negotiate_coding(req.get_header_value("Accept-Encoding"), offered) == ContentCoding::zstd;
+        if (const char* compress = req.url_params.get("compress")) {
+            zstd = std::string(compress) == "zstd";
+            if (!zstd && std::string(compress) != "none") return fail(400, "compress must be zstd or none");
+#if !LIBRARY_WITH_ZSTD
+            if (zstd) return fail(400, "This server was built without zstd support");
+#endif
+        }
+
+        // The spool belongs to the job, which outlives the write of the file to the socket
+        auto spool = std::make_shared<std::optional<ExportSpool>>();
+        answer_from_db(req, res, [table, format, format_param, content_type, zstd, spool]() {
+            const auto started = std::chrono::steady_clock::now();
+            long long rows = 0;
+            try {
+                spool->emplace(export_dir(), zstd);
+                auto session = storage->session();
+                if (table == "books") {
+                    rows = export_rows<Book>(format, **spool, [&](const RowSink<Book>& sink) { return session->books().scan({}, serializing(sink)); });
+                } else if (table == "readers") {
+                    rows = export_rows<Reader>(format, **spool, [&](const RowSink<Reader>& sink) { return session->readers().scan(serializing(sink)); });
+                } else {
+                    rows = export_rows<Record>(format, **spool, [&](const RowSink<Record>& sink) { return session->records().scan(serializing(sink)); });
+                }
+                session.reset();
+                (*spool)->finish();
+            } catch (const PoolExhaustedError& e) {
+                return pool_exhausted_response(e);
+            } catch (const SqlError& e) {
+                return crow::response(500, "Database query failed: " + std::string(e.what()));
+            } catch (const std::runtime_error& e) {
+                return crow::response(500, "Export failed: " + std::string(e.what()));
+            }
+
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            CROW_LOG_INFO << "Exported " << rows << " " << table << " (" << (*spool)->encoded_bytes() << " bytes, "
+                          << (*spool)->file_bytes() << " on the wire) in " << seconds * 1000.0 << " ms";
+
+            crow::response out;
+            out.set_static_file_info_unsafe((*spool)->path());
+            out.set_header("Content-Type", content_type);
+            out.set_header("Content-Disposition", "attachment; filename=\"" + table + "." + format_param + "\"");
+            out.set_header("Vary", "Accept-Encoding");
+            out.set_header("X-Export-Rows", std::to_string(rows));
+            if (zstd) out.set_header("Content-Encoding", "zstd");
+            return out;
+        });
+    });
+
+    // Connection pool counters
+    CROW_ROUTE(app, "/api/pool/stats").methods("GET"_method)([]() {
+        if (!db) return crow::response(404, "No connection pool: storage is in memory");
+        auto json = pool_stats_json(db->pool_stats());
+        json["backend"] = db->name();
+        if (db_executor) {
+            const ExecutorStats executor = db_executor->stats();
+            json["executor"]["threads"] = executor.threads;
+            json["executor"]["busy"] = executor.busy;
+            json["executor"]["queued"] = executor.queued;
+            json["executor"]["queue_limit"] = executor.queue_limit;
+            json["executor"]["completed"] = executor.completed;
+            json["executor"]["rejected"] = executor.rejected;
+        }
+        return crow::response(json);
+    });
+
+    // Catalog cache counters
+    CROW_ROUTE(app, "/api/cache/stats").methods("GET"_method)([]() {
+        crow::json::wvalue json;
+        json["version"] = catalog_cache.version();
+        json["hits"] = catalog_cache.hits();
+        json["misses"] = catalog_cache.misses();
+        json["not_modified"] = catalog_cache.not_modified();
+        return crow::response(json);
+    });
+
+    // Prometheus scrape target
+    CROW_ROUTE(app, "/metrics").methods("GET"_method)([]() {
+        std::string out;
+        out.reserve(64 * 1024);
+        request_metrics.append_prometheus(out);
+        if (db) append_pool_metrics(out, db->pool_stats(), db->name());
+        if (db_executor) append_executor_metrics(out, db_executor->stats());
+        append_compression_metrics(out);
+        if (async_log) {
+            append_metric_header(out, "library_log_lines_total", "counter", "Log lines by what became of them");
+            append_metric(out, "library_log_lines_total", "result=\"written\"", static_cast<double>(async_log->written()));
+            append_metric(out, "library_log_lines_total", "result=\"sampled_out\"", static_cast<double>(async_log->sampled_out()));
+            append_metric(out, "library_log_lines_total", "result=\"dropped\"", static_cast<double>(async_log->dropped()));
         }
+        crow::response res(std::move(out));
+        res.set_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+        return res;
     });
 
     app.port(8080).multithreaded().run();
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "connection_pool.h"
+#include "request_trace.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Backend-neutral access to the library database.
+//
+// Handlers lease a SqlSession (one pooled connection) from the configured SqlDatabase and
+// never see nanodbc or sqlite3 types. Text crosses this boundary as UTF-8 and SQL is written
+// with '?' markers; the few constructs SQL Server and SQLite spell differently go through the
+// SqlDialect helpers below.
+
+enum class SqlDialect { sql_server, sqlite };
+
+// A statement the database rejected; constraint_violation() is set for primary key,
+// unique and check failures so callers can answer 409 instead of 500
+class SqlError : public std::runtime_error {
+public:
+    explicit SqlError(const std::string& message, bool constraint_violation = false)
+        : std::runtime_error(message), constraint_violation_(constraint_violation) {}
+
+    bool constraint_violation() const { return constraint_violation_; }
+
+private:
+    bool constraint_violation_;
+};
+
+// Process-wide prepare counters, summed over every pooled connection of either backend
+struct StatementCacheStats {
+    static inline std::atomic<uint64_t> hits{0};
+    static inline std::atomic<uint64_t> misses{0};
+    static inline std::atomic<uint64_t> evictions{0};
+};
+
+using SqlValue = std::variant<std::nullptr_t, long long, double, std::string>;
+
+// Current row of a query; columns are numbered from 0 in SELECT order and NULL reads as
+// an empty string or zero
+class SqlRow {
+public:
+    virtual ~SqlRow() = default;
+
+    virtual bool is_null(short col) = 0;
+    // Reads the column into out, reusing its capacity
+    virtual void text(short col, std::string& out) = 0;
+    virtual long long integer(short col) = 0;
+    virtual double real(short col) = 0;
+};
+
+using SqlRowHandler = std::function<void(SqlRow&)>;
+
+class SqlSession {
+public:
+    virtual ~SqlSession() = default;
+
+    // Runs a SELECT and calls on_row for every row; returns the number of rows
+    virtual long long query(const std::string& sql, const std::vector<SqlValue>& params, const SqlRowHandler& on_row) = 0;
+    // Runs an INSERT/UPDATE/DELETE through the connection's statement cache; returns affected rows
+    virtual long long execute(const std::string& sql, const std::vector<SqlValue>& params) = 0;
+    // Runs one INSERT/UPDATE/DELETE for every parameter row, as a single array-bound execute
+    // where the driver supports it, and returns the rows written. A column must hold the same
+    // type (or NULL) in every row. When some rows fail the result is fewer than rows.size(), or
+    // SqlError; either way the rows that did go in stay, so callers wrap it in a savepoint.
+    virtual long long execute_batch(const std::string& sql, const std::vector<std::vector<SqlValue>>& rows) = 0;
+
+    virtual void begin() = 0;
+    virtual void commit() = 0;
+    virtual void rollback() = 0;
+};
+
+class SqlDatabase {
+public:
+    virtual ~SqlDatabase() = default;
+
+    virtual SqlDialect dialect() const = 0;
+    virtual const char* name() const = 0;
+    // Leases a pooled connection for the lifetime of the session; throws PoolExhaustedError
+    // when none frees up before the acquire timeout
+    virtual std::unique_ptr<SqlSession> session() = 0;
+    virtual PoolStats pool_stats() const = 0;
+};
+
+// Notes sql and its parameters for the request running on this thread (see request_trace.h).
+// SQL is cut at 256 bytes, text parameters at 64 and lists at 16 values; batches show their
+// first row.
+inline void trace_statement(const std::string& sql, const std::vector<SqlValue>& params, size_t batch_rows = 0) {
+    PhaseClock& clock = PhaseClock::current();
+    if (!clock.wants_statement()) return;
+    std::string out = sql.substr(0, 256);
+    if (sql.size() > 256) out += "...";
+    out += " [";
+    for (size_t i = 0; i < params.size() && i < 16; ++i) {
+        if (i) out += ", ";
+        if (const auto* text = std::get_if<std::string>(&params[i])) {
+            out += '\'';
+            out.append(*text, 0, 64);
+            if (text->size() > 64) out += "...";
+            out += '\'';
+        } else if (const auto* integer = std::get_if<long long>(&params[i])) {
+            out += std::to_string(*integer);
+        } else if (const auto* real = std::get_if<double>(&params[i])) {
+            out += std::to_string(*real);
+        } else {
+            out += "NULL";
+        }
+    }
+    if (params.size() > 16) out += ", ...";
+    out += ']';
+    if (batch_rows > 1) out += " x " + std::to_string(batch_rows) + " rows";
+    clock.note_statement(std::move(out));
+}
+
+// First column of the first row as an integer (COUNT(*) and friends); 0 when there is no row
+inline long long query_integer(SqlSession& session, const std::string& sql, const std::vector<SqlValue>& params = {}) {
+    long long value = 0;
+    session.query(sql, params, [&](SqlRow& row) { value = row.integer(0); });
+    return value;
+}
+
+// Appends a row limit to a query that already ends in ORDER BY, with its parameters in marker order
+inline void append_row_limit(std::string& sql, std::vector<SqlValue>& params, SqlDialect dialect,
+                             long long limit, long long offset = 0) {
+    if (dialect == SqlDialect::sqlite) {
+        sql += " LIMIT ? OFFSET ?";
+        params.emplace_back(limit);
+        params.emplace_back(offset);
+    } else {
+        sql += " OFFSET ? ROWS FETCH NEXT ? ROWS ONLY";
+        params.emplace_back(offset);
+        params.emplace_back(limit);
+    }
+}
+
+// Table hint for a SELECT that must keep the rows it read (or did not find) from being written
+// by anyone else until the transaction ends. SQLite needs none: BEGIN IMMEDIATE already holds
+// the database write lock.
+inline const char* locking_read_hint(SqlDialect dialect) {
+    return dialect == SqlDialect::sql_server ? " WITH (UPDLOCK, HOLDLOCK)" : "";
+}
+
+// A key the way the database compares it for equality: SQL Server's default collations ignore
+// case and trailing spaces, SQLite's BINARY compares bytes. Only ASCII is folded; a non-ASCII
+// case match shows up as a constraint violation instead (see SqlBookRepository::insert_many).
+inline std::string comparable_key(SqlDialect dialect, std::string key) {
+    if (dialect == SqlDialect::sqlite) return key;
+    while (!key.empty() && key.back() == ' ') key.pop_back();
+    for (auto& c : key) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return key;
+}
+
+// Savepoints inside an open transaction. SQL Server has no RELEASE; its savepoints end with the
+// transaction, so release_savepoint_sql() is empty there.
+inline std::string savepoint_sql(SqlDialect dialect, const std::string& name) {
+    return (dialect == SqlDialect::sqlite ? "SAVEPOINT " : "SAVE TRANSACTION ") + name;
+}
+
+inline std::string rollback_to_savepoint_sql(SqlDialect dialect, const std::string& name) {
+    return (dialect == SqlDialect::sqlite ? "ROLLBACK TO " : "ROLLBACK TRANSACTION ") + name;
+}
+
+inline std::string release_savepoint_sql(SqlDialect dialect, const std::string& name) {
+    return dialect == SqlDialect::sqlite ? "RELEASE " + name : std::string();
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+#include "book_search.h"
+#include "models.h"
+#include "repository.h"
+#include "sql_database.h"
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Repositories over a SqlSession. The SQL is shared by SQL Server and SQLite; the only
+// dialect-specific piece is the row limit, which goes through append_row_limit.
+
+namespace sql_repository_detail {
+
+// Column lists in the order the read_* functions below expect
+inline const std::string book_columns = "book_id, book_name, book_isbn, book_author, book_publisher, interview_times, book_price";
+inline const std::string reader_columns = "reader_id, reader_name, reader_sex, reader_department";
+// CHAR key columns come back blank-padded from SQL Server
+inline const std::string record_columns = "RTRIM(reader_id), RTRIM(book_id), borrow_date, return_date, notes";
+
+inline void read_book(SqlRow& row, Book& book) {
+    row.text(0, book.book_id);
+    row.text(1, book.book_name);
+    row.text(2, book.book_isbn);
+    row.text(3, book.book_author);
+    row.text(4, book.book_publisher);
+    book.interview_times = static_cast<int>(row.integer(5));
+    book.book_price = row.real(6);
+}
+
+inline void read_reader(SqlRow& row, Reader& reader) {
+    row.text(0, reader.reader_id);
+    row.text(1, reader.reader_name);
+    row.text(2, reader.reader_sex);
+    row.text(3, reader.reader_department);
+}
+
+inline void read_optional_text(SqlRow& row, short col, std::optional<std::string>& out) {
+    if (row.is_null(col)) {
+        out.reset();
+    } else {
+        row.text(col, out ? *out : out.emplace());
+    }
+}
+
+inline void read_record(SqlRow& row, Record& record) {
+    row.text(0, record.reader_id);
+    row.text(1, record.book_id);
+    row.text(2, record.borrow_date);
+    read_optional_text(row, 3, record.return_date);
+    read_optional_text(row, 4, record.notes);
+}
+
+inline SqlValue optional_value(const std::optional<std::string>& value) {
+    if (value) return *value;
+    return nullptr;
+}
+
+}  // namespace sql_repository_detail
+
+class SqlBookRepository : public BookRepository {
+public:
+    SqlBookRepository(SqlSession& session, SqlDialect dialect) : session_(session), dialect_(dialect) {}
+
+    long long scan(const BookScan& scan, const RowSink<Book>& sink) override {
+        using namespace sql_repository_detail;
+        std::string sql = "SELECT " + book_columns + " FROM book";
+        std::vector<SqlValue> params;
+        if (scan.limit > 0) {
+            // Keyset (after) is an index range scan on the primary key; offset is kept for
+            // random page jumps but gets slower the deeper it goes
+            if (scan.offset == 0 && !scan.after.empty()) {
+                sql += " WHERE book_id > ?";
+                params.emplace_back(scan.after);
+            }
+            sql += " ORDER BY book_id";
+            append_row_limit(sql, params, dialect_, scan.limit, scan.offset);
+        }
+        return query(sql, params, sink);
+    }
+
+    long long count() override {
+        return query_integer(session_, "SELECT COUNT(*) FROM book");
+    }
+
+    std::optional<Book> find(const std::string& book_id) override {
+        using namespace sql_repository_detail;
+        std::optional<Book> book;
+        session_.query("SELECT " + book_columns + " FROM book WHERE book_id = ?", {book_id},
+                       [&](SqlRow& row) { read_book(row, book.emplace()); });
+        return book;
+    }
+
+    // See book_search.h for how each filter is planned
+    long long search(const BookSearchRequest& request, const RowSink<Book>& sink, std::vector<std::string>& plan) override {
+        const BookSearchPlan search = plan_book_search(request);
+        std::vector<SqlValue> params;
+        params.reserve(search.params.size());
+        for (const auto& param : search.params) {
+            if (const auto* text = std::get_if<std::string>(&param)) {
+                params.emplace_back(*text);
+            } else {
+                params.emplace_back(std::get<double>(param));
+            }
+        }
+        plan.insert(plan.end(), search.steps.begin(), search.steps.end());
+        return query(search.sql, params, sink);
+    }
+
+    void insert(const Book& book) override {
+        using namespace sql_repository_detail;
+        session_.execute("INSERT INTO book (" + book_columns + ") VALUES (?, ?, ?, ?, ?, ?, ?)",
+                         {book.book_id, book.book_name, book.book_isbn, book.book_author, book.book_publisher,
+                          static_cast<long long>(book.interview_times), book.book_price});
+    }
+
+    // Runs inside a transaction. Each batch first locks the keys it is about to insert
+    // (locking_read_hint), so the duplicates found by that read cannot change before the array
+    // insert runs. Keys are matched the way the database compares them (comparable_key). A
+    // duplicate the check still misses, such as a non-ASCII case variant, fails the array insert;
+    // the batch is then rolled back to its savepoint and inserted row by row, and only the rows
+    // the database rejects are reported.
+    BulkInsertResult insert_many(const std::vector<Book>& books, size_t batch_size) override {
+        using namespace sql_repository_detail;
+        const std::string insert_sql = "INSERT INTO book (" + book_columns + ") VALUES (?, ?, ?, ?, ?, ?, ?)";
+        const std::string savepoint = "bulk_batch";
+        BulkInsertResult result;
+        std::unordered_set<std::string> seen;
+        std::unordered_set<std::string> existing;
+        std::vector<SqlValue> ids;
+        std::vector<std::vector<SqlValue>> rows;
+        std::vector<size_t> positions;  // Index in books of every entry in rows
+        batch_size = std::max<size_t>(batch_size, 1);
+
+        for (size_t start = 0; start < books.size(); start += batch_size) {
+            const size_t end = std::min(books.size(), start + batch_size);
+
+            ids.clear();
+            std::string sql = "SELECT book_id FROM book";
+            sql += locking_read_hint(dialect_);
+            sql += " WHERE book_id IN (";
+            for (size_t i = start; i < end; ++i) {
+                sql += i == start ? "?" : ", ?";
+                ids.emplace_back(books[i].book_id);
+            }
+            sql += ")";
+            existing.clear();
+            std::string id;
+            session_.query(sql, ids, [&](SqlRow& row) {
+                row.text(0, id);
+                existing.insert(comparable_key(dialect_, id));
+            });
+
+            rows.clear();
+            positions.clear();
+            for (size_t i = start; i < end; ++i) {
+                const Book& book = books[i];
+                const std::string key = comparable_key(dialect_, book.book_id);
+                if (existing.count(key) || !seen.insert(key).second) {
+                    result.duplicates.push_back(i);
+                    continue;
+                }
+                rows.push_back({book.book_id, book.book_name, book.book_isbn, book.book_author, book.book_publisher,
+                                static_cast<long long>(book.interview_times), book.book_price});
+                positions.push_back(i);
+            }
+            if (rows.empty()) continue;
+
+            session_.execute(savepoint_sql(dialect_, savepoint), {});
+            long long written = 0;
+            try {
+                written = session_.execute_batch(insert_sql, rows);
+            } catch (const SqlError& e) {
+                if (!e.constraint_violation()) throw;
+                written = -1;
+            }
+            if (written != static_cast<long long>(rows.size())) {
+                session_.execute(rollback_to_savepoint_sql(dialect_, savepoint), {});
+                written = 0;
+                for (size_t r = 0; r < rows.size(); ++r) {
+                    try {
+                        written += session_.execute(insert_sql, rows[r]);
+                    } catch (const SqlError& e) {
+                        if (!e.constraint_violation()) throw;
+                        result.duplicates.push_back(positions[r]);
+                    }
+                }
+                std::sort(result.duplicates.begin(), result.duplicates.end());
+            }
+            const std::string release = release_savepoint_sql(dialect_, savepoint);
+            if (!release.empty()) session_.execute(release, {});
+            result.inserted += written;
+        }
+        return result;
+    }
+
+    bool update(const Book& book) override {
+        return session_.execute(
+                   "UPDATE book SET book_name=?, book_isbn=?, book_author=?, book_publisher=?, interview_times=?, book_price=? WHERE book_id=?",
+                   {book.book_name, book.book_isbn, book.book_author, book.book_publisher,
+                    static_cast<long long>(book.interview_times), book.book_price, book.book_id}) > 0;
+    }
+
+    bool remove(const std::string& book_id) override {
+        return session_.execute("DELETE FROM book WHERE book_id = ?", {book_id}) > 0;
+    }
+
+private:
+    // One Book is reused for every row so its strings keep their capacity
+    long long query(const std::string& sql, const std::vector<SqlValue>& params, const RowSink<Book>& sink) {
+        Book book;
+        return session_.query(sql, params, [&](SqlRow& row) {
+            sql_repository_detail::read_book(row, book);
+            sink(book);
+        });
+    }
+
+    SqlSession& session_;
+    SqlDialect dialect_;
+};
+
+class SqlReaderRepository : public ReaderRepository {
+public:
+    explicit SqlReaderRepository(SqlSession& session) : session_(session) {}
+
+    long long scan(const RowSink<Reader>& sink) override {
+        using namespace sql_repository_detail;
+        Reader reader;
+        return session_.query("SELECT " + reader_columns + " FROM reader", {}, [&](SqlRow& row) {
+            read_reader(row, reader);
+            sink(reader);
+        });
+    }
+
+    std::optional<Reader> find(const std::string& reader_id) override {
+        using namespace sql_repository_detail;
+        std::optional<Reader> reader;
+        session_.query("SELECT " + reader_columns + " FROM reader WHERE reader_id = ?", {reader_id},
+                       [&](SqlRow& row) { read_reader(row, reader.emplace()); });
+        return reader;
+    }
+
+    void insert(const Reader& reader) override {
+        using namespace sql_repository_detail;
+        session_.execute("INSERT INTO reader (" + reader_columns + ") VALUES (?, ?, ?, ?)",
+                         {reader.reader_id, reader.reader_name, reader.reader_sex, reader.reader_department});
+    }
+
+    bool update(const Reader& reader) override {
+        return session_.execute("UPDATE reader SET reader_name=?, reader_sex=?, reader_department=? WHERE reader_id=?",
+                                {reader.reader_name, reader.reader_sex, reader.reader_department, reader.reader_id}) > 0;
+    }
+
+    bool remove(const std::string& reader_id) override {
+        return session_.execute("DELETE FROM reader WHERE reader_id = ?", {reader_id}) > 0;
+    }
+
+private:
+    SqlSession& session_;
+};
+
+class SqlRecordRepository : public RecordRepository {
+public:
+    explicit SqlRecordRepository(SqlSession& session) : session_(session) {}
+
+    long long scan(const RowSink<Record>& sink) override {
+        using namespace sql_repository_detail;
+        Record record;
+        return session_.query("SELECT " + record_columns + " FROM record", {}, [&](SqlRow& row) {
+            read_record(row, record);
+            sink(record);
+        });
+    }
+
+    std::optional<Record> find(const std::string& book_id, const std::string& reader_id) override {
+        using namespace sql_repository_detail;
+        std::optional<Record> record;
+        session_.query("SELECT " + record_columns + " FROM record WHERE book_id = ? AND reader_id = ?", {book_id, reader_id},
+                       [&](SqlRow& row) { read_record(row, record.emplace()); });
+        return record;
+    }
+
+    void insert(const Record& record) override {
+        using namespace sql_repository_detail;
+        session_.execute("INSERT INTO record (book_id, reader_id, borrow_date, return_date, notes) VALUES (?, ?, ?, ?, ?)",
+                         {record.book_id, record.reader_id, record.borrow_date,
+                          optional_value(record.return_date), optional_value(record.notes)});
+    }
+
+    bool update(const Record& record) override {
+        using namespace sql_repository_detail;
+        return session_.execute("UPDATE record SET borrow_date=?, return_date=?, notes=? WHERE book_id=? AND reader_id=?",
+                                {record.borrow_date, optional_value(record.return_date), optional_value(record.notes),
+                                 record.book_id, record.reader_id}) > 0;
+    }
+
+    bool remove(const std::string& book_id, const std::string& reader_id) override {
+        return session_.execute("DELETE FROM record WHERE book_id = ? AND reader_id = ?", {book_id, reader_id}) > 0;
+    }
+
+private:
+    SqlSession& session_;
+};
+
+class SqlStorageSession : public StorageSession {
+public:
+    SqlStorageSession(std::unique_ptr<SqlSession> session, SqlDialect dialect)
+        : session_(std::move(session)), books_(*session_, dialect), readers_(*session_), records_(*session_) {}
+
+    BookRepository& books() override { return books_; }
+    ReaderRepository& readers() override { return readers_; }
+    RecordRepository& records() override { return records_; }
+
+    void begin() override { session_->begin(); }
+    void commit() override { session_->commit(); }
+    void rollback() override { session_->rollback(); }
+
+private:
+    std::unique_ptr<SqlSession> session_;
+    SqlBookRepository books_;
+    SqlReaderRepository readers_;
+    SqlRecordRepository records_;
+};
+
+class SqlStorage : public Storage {
+public:
+    explicit SqlStorage(SqlDatabase& db) : db_(db) {}
+
+    const char* name() const override { return db_.name(); }
+
+    std::unique_ptr<StorageSession> session() override {
+        return std::make_unique<SqlStorageSession>(db_.session(), db_.dialect());
+    }
+
+private:
+    SqlDatabase& db_;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "sql_database.h"
+#include <sqlite3.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+struct SqliteOptions {
+    std::string path = "library.db";
+    long long mmap_size = 256LL * 1024 * 1024;  // Bytes of the file read through mmap instead of read()
+    int cache_size_kib = 16 * 1024;             // Page cache per connection
+    int busy_timeout_ms = 5000;                 // How long a writer waits for the write lock
+};
+
+// An open SQLite database handle together with the statements prepared on it.
+// Mirrors OdbcConnection: statements are keyed by SQL text, least recently used ones are
+// finalized once the cache is full, and they are reset and unbound before being handed out.
+// Each connection is used by one thread at a time (the pool guarantees that), so the handle
+// is opened without SQLite's own per-connection mutex.
+class SqliteConnection {
+public:
+    static constexpr size_t default_cache_capacity = 32;
+
+    explicit SqliteConnection(const SqliteOptions& options, size_t cache_capacity = default_cache_capacity)
+        : capacity_(cache_capacity ? cache_capacity : 1) {
+        const int rc = sqlite3_open_v2(options.path.c_str(), &db_,
+                                       SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (rc != SQLITE_OK) {
+            const std::string message = db_ ? sqlite3_errmsg(db_) : sqlite3_errstr(rc);
+            sqlite3_close_v2(db_);
+            db_ = nullptr;
+            throw SqlError("Cannot open " + options.path + ": " + message);
+        }
+        sqlite3_busy_timeout(db_, options.busy_timeout_ms);
+        sqlite3_extended_result_codes(db_, 1);
+
+        // WAL lets readers run alongside the single writer; NORMAL only syncs at checkpoints,
+        // which is durable against process crashes and loses at most the last commits on power loss
+        exec("PRAGMA journal_mode=WAL");
+        exec("PRAGMA synchronous=NORMAL");
+        exec("PRAGMA temp_store=MEMORY");
+        exec("PRAGMA mmap_size=" + std::to_string(options.mmap_size));
+        exec("PRAGMA cache_size=-" + std::to_string(options.cache_size_kib));
+    }
+
+    ~SqliteConnection() {
+        // Statements must be finalized before the handle can close
+        index_.clear();
+        entries_.clear();
+        sqlite3_close_v2(db_);
+    }
+
+    SqliteConnection(const SqliteConnection&) = delete;
+    SqliteConnection& operator=(const SqliteConnection&) = delete;
+
+    sqlite3* native() { return db_; }
+
+    // Runs one or more statements that take no parameters
+    void exec(const std::string& sql) {
+        char* error = nullptr;
+        if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+            const std::string message = error ? error : sqlite3_errmsg(db_);
+            sqlite3_free(error);
+            throw SqlError(message, is_constraint(sqlite3_extended_errcode(db_)));
+        }
+    }
+
+    // Returns a statement prepared for sql, preparing it on first use
+    sqlite3_stmt* prepared(const std::string& sql) {
+        auto found = index_.find(sql);
+        if (found != index_.end()) {
+            StatementCacheStats::hits.fetch_add(1, std::memory_order_relaxed);
+            entries_.splice(entries_.begin(), entries_, found->second);
+            sqlite3_stmt* stmt = found->second->second.get();
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            return stmt;
+        }
+
+        StatementCacheStats::misses.fetch_add(1, std::memory_order_relaxed);
+        sqlite3_stmt* raw = nullptr;
+        if (sqlite3_prepare_v3(db_, sql.c_str(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &raw, nullptr) != SQLITE_OK) {
+            throw error();
+        }
+        StatementPtr stmt(raw);
+
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+            StatementCacheStats::evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        entries_.emplace_front(sql, std::move(stmt));
+        index_.emplace(sql, entries_.begin());
+        return raw;
+    }
+
+    // The last error on this handle as an exception
+    SqlError error() const {
+        return SqlError(sqlite3_errmsg(db_), is_constraint(sqlite3_extended_errcode(db_)));
+    }
+
+    size_t cached_statements() const { return entries_.size(); }
+
+private:
+    struct Finalize {
+        void operator()(sqlite3_stmt* stmt) const { sqlite3_finalize(stmt); }
+    };
+    using StatementPtr = std::unique_ptr<sqlite3_stmt, Finalize>;
+    using Entry = std::pair<std::string, StatementPtr>;
+
+    static bool is_constraint(int code) { return (code & 0xFF) == SQLITE_CONSTRAINT; }
+
+    sqlite3* db_ = nullptr;
+    size_t capacity_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
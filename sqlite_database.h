@@ -0,0 +1,266 @@
+#pragma once
+
+#include "book_search.h"
+#include "connection_pool.h"
+#include "request_trace.h"
+#include "sql_database.h"
+#include "sqlite_connection.h"
+#include <sqlite3.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Embedded SQLite file behind the SqlDatabase interface, so the server runs without a
+// database server. Every pooled connection opens the same file; in WAL mode readers never
+// block each other or the writer, and writers queue on busy_timeout.
+//
+// On first open the file gets the same book/reader/record tables (and the book indexes listed
+// in book_search.h) as the SQL Server database. Rows from the legacy `books` table that the
+// original library.db shipped with are copied into `book` once.
+
+class SqliteRow : public SqlRow {
+public:
+    explicit SqliteRow(sqlite3_stmt* stmt) : stmt_(stmt) {}
+
+    bool is_null(short col) override { return sqlite3_column_type(stmt_, col) == SQLITE_NULL; }
+
+    void text(short col, std::string& out) override {
+        const auto* data = sqlite3_column_text(stmt_, col);
+        const int size = sqlite3_column_bytes(stmt_, col);
+        out.assign(data ? reinterpret_cast<const char*>(data) : "", data ? static_cast<size_t>(size) : 0);
+    }
+
+    long long integer(short col) override { return sqlite3_column_int64(stmt_, col); }
+    double real(short col) override { return sqlite3_column_double(stmt_, col); }
+
+private:
+    sqlite3_stmt* stmt_;
+};
+
+class SqliteSession : public SqlSession {
+public:
+    explicit SqliteSession(ConnectionLease<SqliteConnection> conn) : conn_(std::move(conn)) {}
+
+    ~SqliteSession() override {
+        if (in_transaction_) {
+            try {
+                conn_->exec("ROLLBACK");
+            } catch (const SqlError&) {
+                conn_.mark_broken();
+            }
+        }
+    }
+
+    long long query(const std::string& sql, const std::vector<SqlValue>& params, const SqlRowHandler& on_row) override {
+        PhaseTimer timer(RequestPhase::execute);
+        trace_statement(sql, params);
+        sqlite3_stmt* stmt = conn_->prepared(sql);
+        ResetOnExit reset{stmt};
+        bind(stmt, params);
+
+        SqliteRow row(stmt);
+        long long count = 0;
+        int rc = sqlite3_step(stmt);  // Runs the plan up to the first row
+        timer.change(RequestPhase::fetch);
+        for (; rc == SQLITE_ROW; rc = sqlite3_step(stmt)) {
+            on_row(row);
+            ++count;
+        }
+        if (rc != SQLITE_DONE) throw conn_->error();
+        return count;
+    }
+
+    long long execute(const std::string& sql, const std::vector<SqlValue>& params) override {
+        PhaseTimer timer(RequestPhase::execute);
+        trace_statement(sql, params);
+        sqlite3_stmt* stmt = conn_->prepared(sql);
+        ResetOnExit reset{stmt};
+        bind(stmt, params);
+
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        }
+        if (rc != SQLITE_DONE) throw conn_->error();
+        return sqlite3_changes(conn_->native());
+    }
+
+    // SQLite has no parameter arrays; stepping the one cached statement per row is its equivalent
+    long long execute_batch(const std::string& sql, const std::vector<std::vector<SqlValue>>& rows) override {
+        PhaseTimer timer(RequestPhase::execute);
+        if (!rows.empty()) trace_statement(sql, rows.front(), rows.size());
+        sqlite3_stmt* stmt = conn_->prepared(sql);
+        ResetOnExit reset{stmt};
+        long long changes = 0;
+        for (const auto& params : rows) {
+            sqlite3_reset(stmt);
+            bind(stmt, params);
+            int rc;
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            }
+            if (rc != SQLITE_DONE) throw conn_->error();
+            changes += sqlite3_changes(conn_->native());
+        }
+        return changes;
+    }
+
+    // IMMEDIATE takes the write lock up front, so two transactions never deadlock upgrading from a read
+    void begin() override {
+        PhaseTimer timer(RequestPhase::execute);
+        conn_->exec("BEGIN IMMEDIATE");
+        in_transaction_ = true;
+    }
+
+    void commit() override {
+        PhaseTimer timer(RequestPhase::execute);
+        if (!in_transaction_) return;
+        conn_->exec("COMMIT");
+        in_transaction_ = false;
+    }
+
+    void rollback() override {
+        PhaseTimer timer(RequestPhase::execute);
+        if (!in_transaction_) return;
+        in_transaction_ = false;
+        conn_->exec("ROLLBACK");
+    }
+
+private:
+    // Leaves cached statements reset so they release their read snapshot
+    struct ResetOnExit {
+        sqlite3_stmt* stmt;
+        ~ResetOnExit() { sqlite3_reset(stmt); }
+    };
+
+    // Parameters are bound SQLITE_STATIC: params outlives every step of the statement
+    void bind(sqlite3_stmt* stmt, const std::vector<SqlValue>& params) {
+        for (size_t i = 0; i < params.size(); ++i) {
+            const int index = static_cast<int>(i) + 1;
+            int rc;
+            if (const auto* text = std::get_if<std::string>(&params[i])) {
+                rc = sqlite3_bind_text(stmt, index, text->data(), static_cast<int>(text->size()), SQLITE_STATIC);
+            } else if (const auto* integer = std::get_if<long long>(&params[i])) {
+                rc = sqlite3_bind_int64(stmt, index, *integer);
+            } else if (const auto* real = std::get_if<double>(&params[i])) {
+                rc = sqlite3_bind_double(stmt, index, *real);
+            } else {
+                rc = sqlite3_bind_null(stmt, index);
+            }
+            if (rc != SQLITE_OK) throw conn_->error();
+        }
+    }
+
+    ConnectionLease<SqliteConnection> conn_;
+    bool in_transaction_ = false;
+};
+
+class SqliteDatabase : public SqlDatabase {
+public:
+    SqliteDatabase(SqliteOptions options, PoolOptions pool_options)
+        : options_(std::move(options)) {
+        // Create the schema before the pool opens its connections, so none of them
+        // caches a statement compiled against a missing table
+        SqliteConnection setup(options_);
+        migrate(setup);
+        pool_ = std::make_unique<BasicConnectionPool<SqliteConnection>>(
+            [this] { return std::make_unique<SqliteConnection>(options_); },
+            nullptr, pool_options);
+    }
+
+    SqlDialect dialect() const override { return SqlDialect::sqlite; }
+    const char* name() const override { return "sqlite"; }
+
+    std::unique_ptr<SqlSession> session() override {
+        PhaseTimer timer(RequestPhase::pool_wait);
+        return std::make_unique<SqliteSession>(pool_->acquire());
+    }
+
+    PoolStats pool_stats() const override { return pool_->stats(); }
+
+private:
+    // PRAGMA user_version records how far the file has been migrated
+    static void migrate(SqliteConnection& conn) {
+        int version = 0;
+        {
+            sqlite3_stmt* stmt = conn.prepared("PRAGMA user_version");
+            if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+            sqlite3_reset(stmt);
+        }
+        if (version >= 4) return;
+
+        conn.exec("BEGIN IMMEDIATE");
+        try {
+            if (version < 1) create_tables(conn);
+            if (version < 2) {
+                // Records are keyed by (book_id, reader_id), as in the SQL Server schema
+                conn.exec("CREATE UNIQUE INDEX IF NOT EXISTS ux_record_book_reader ON record(book_id, reader_id)");
+            }
+            if (version < 3) {
+                // SQLite's LIKE is case-insensitive, so a prefix LIKE can only seek an index in
+                // NOCASE order; the BINARY indexes stay for the equality lookups
+                conn.exec(
+                    "CREATE INDEX IF NOT EXISTS ix_book_name_nocase ON book(book_name COLLATE NOCASE);"
+                    "CREATE INDEX IF NOT EXISTS ix_book_author_nocase ON book(book_author COLLATE NOCASE);"
+                    "CREATE INDEX IF NOT EXISTS ix_book_publisher_nocase ON book(book_publisher COLLATE NOCASE);"
+                    "CREATE INDEX IF NOT EXISTS ix_book_isbn_nocase ON book(book_isbn COLLATE NOCASE);");
+            }
+            if (version < 4) {
+                // ISBN lookups compare the stored value with separators stripped (see
+                // normalized_isbn_sql); the expression must match the query's text exactly
+                conn.exec("CREATE INDEX IF NOT EXISTS ix_book_isbn_normalized ON book(" + normalized_isbn_sql + ")");
+            }
+            conn.exec("PRAGMA user_version = 4");
+            conn.exec("COMMIT");
+        } catch (...) {
+            conn.exec("ROLLBACK");
+            throw;
+        }
+    }
+
+    static void create_tables(SqliteConnection& conn) {
+        conn.exec(
+            "CREATE TABLE IF NOT EXISTS book ("
+            "  book_id TEXT PRIMARY KEY,"
+            "  book_name TEXT NOT NULL DEFAULT '',"
+            "  book_isbn TEXT NOT NULL DEFAULT '',"
+            "  book_author TEXT NOT NULL DEFAULT '',"
+            "  book_publisher TEXT NOT NULL DEFAULT '',"
+            "  interview_times INTEGER NOT NULL DEFAULT 0,"
+            "  book_price REAL NOT NULL DEFAULT 0"
+            ") WITHOUT ROWID;"
+            "CREATE INDEX IF NOT EXISTS ix_book_name ON book(book_name);"
+            "CREATE INDEX IF NOT EXISTS ix_book_author ON book(book_author);"
+            "CREATE INDEX IF NOT EXISTS ix_book_publisher ON book(book_publisher);"
+            "CREATE INDEX IF NOT EXISTS ix_book_isbn ON book(book_isbn);"
+            "CREATE INDEX IF NOT EXISTS ix_book_price ON book(book_price);"
+            "CREATE TABLE IF NOT EXISTS reader ("
+            "  reader_id TEXT PRIMARY KEY,"
+            "  reader_name TEXT NOT NULL DEFAULT '',"
+            "  reader_sex TEXT NOT NULL DEFAULT '',"
+            "  reader_department TEXT NOT NULL DEFAULT ''"
+            ") WITHOUT ROWID;"
+            "CREATE TABLE IF NOT EXISTS record ("
+            "  reader_id TEXT NOT NULL,"
+            "  book_id TEXT NOT NULL,"
+            "  borrow_date TEXT NOT NULL,"
+            "  return_date TEXT,"
+            "  notes TEXT"
+            ");"
+            "CREATE INDEX IF NOT EXISTS ix_record_reader ON record(reader_id);"
+            "CREATE INDEX IF NOT EXISTS ix_record_book ON record(book_id);");
+
+        bool has_legacy_books = false;
+        {
+            sqlite3_stmt* stmt = conn.prepared("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'books'");
+            has_legacy_books = sqlite3_step(stmt) == SQLITE_ROW;
+            sqlite3_reset(stmt);
+        }
+        if (has_legacy_books) {
+            conn.exec(
+                "INSERT OR IGNORE INTO book (book_id, book_name, book_isbn, book_author) "
+                "SELECT CAST(id AS TEXT), COALESCE(title, ''), COALESCE(isbn, ''), COALESCE(author, '') FROM books");
+        }
+    }
+
+    SqliteOptions options_;
+    std::unique_ptr<BasicConnectionPool<SqliteConnection>> pool_;
+};
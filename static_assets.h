@@ -0,0 +1,205 @@
+#pragma once
+
+#include "compression.h"
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Front-end files (index.html and anything next to it) served by this server, so the page and
+// the API it calls share one origin.
+//
+// load() reads the web files at the top of a directory (by extension; nothing else there is
+// exposed) once, at startup. Each is kept in memory with one body per content coding: a
+// precompressed sibling (index.html.gz, index.html.zst) when one is at least as new as the file,
+// otherwise compressed at load with the codecs this build has, when that saves bytes. A request
+// is a lookup and a copy of the chosen body into the response, without touching the disk.
+//
+// Every asset has a strong ETag and a second, content-addressed name (app.js -> app.<hash>.js).
+// References to other assets in the HTML files are rewritten to those names, which never change
+// content and can be cached for a year; the pages and plain names are revalidated instead.
+
+struct StaticAsset {
+    std::string name;         // File name, e.g. "index.html"
+    std::string hashed_name;  // Content-addressed name, e.g. "index.3f9c1e07a2b4d5c6.html"
+    std::string content_type;
+    std::string etag;
+    std::array<std::optional<std::string>, content_coding_count> bodies;  // identity is always set
+
+    std::array<bool, content_coding_count> offered() const {
+        std::array<bool, content_coding_count> codings{};
+        for (size_t i = 0; i < content_coding_count; ++i) codings[i] = bodies[i].has_value();
+        return codings;
+    }
+};
+
+class StaticAssets {
+public:
+    // URL prefix the content-addressed names are served under
+    static constexpr std::string_view prefix = "/static/";
+
+    // Loads the web files in dir, replacing what was loaded before; returns how many.
+    // Throws std::filesystem::filesystem_error or std::runtime_error when dir cannot be read.
+    size_t load(const std::filesystem::path& dir, const CompressionOptions& options) {
+        std::vector<StaticAsset> assets;
+        std::vector<std::filesystem::path> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (!entry.is_regular_file()) continue;
+            const std::string name = entry.path().filename().string();
+            const std::string type = content_type(entry.path().extension().string());
+            if (name.empty() || name[0] == '.' || type.empty()) continue;
+            StaticAsset asset;
+            asset.name = name;
+            asset.content_type = type;
+            asset.bodies[0] = read_file(entry.path());
+            assets.push_back(std::move(asset));
+            paths.push_back(entry.path());
+        }
+
+        // Other assets first, so the pages can point at their final names
+        for (auto& asset : assets) {
+            if (!is_html(asset)) name_by_content(asset);
+        }
+        for (size_t i = 0; i < assets.size(); ++i) {
+            StaticAsset& asset = assets[i];
+            bool rewritten = false;
+            if (is_html(asset)) {
+                std::string& body = *asset.bodies[0];
+                for (const auto& other : assets) {
+                    if (is_html(other)) continue;
+                    const std::string url = std::string(prefix) + other.hashed_name;
+                    rewritten |= replace_all(body, "\"" + other.name + "\"", "\"" + url + "\"");
+                    rewritten |= replace_all(body, "'" + other.name + "'", "'" + url + "'");
+                }
+                name_by_content(asset);
+            }
+            // A rewritten page no longer matches what was precompressed on disk
+            if (!rewritten) load_precompressed(asset, paths[i]);
+            compress_missing(asset, options);
+        }
+
+        by_name_.clear();
+        for (size_t i = 0; i < assets.size(); ++i) {
+            by_name_[assets[i].name] = {i, false};
+            by_name_[assets[i].hashed_name] = {i, true};
+        }
+        assets_ = std::move(assets);
+        return assets_.size();
+    }
+
+    // Asset by file name or content-addressed name; immutable is set for the latter
+    const StaticAsset* find(std::string_view name, bool& immutable) const {
+        const auto found = by_name_.find(std::string(name));
+        if (found == by_name_.end()) return nullptr;
+        immutable = found->second.immutable;
+        return &assets_[found->second.index];
+    }
+
+    const std::vector<StaticAsset>& assets() const { return assets_; }
+
+private:
+    struct Entry {
+        size_t index = 0;
+        bool immutable = false;
+    };
+
+    // Content-Type for a file extension; empty for files that are not served
+    static std::string content_type(std::string extension) {
+        for (auto& c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        static const std::unordered_map<std::string, std::string> types = {
+            {".html", "text/html; charset=utf-8"},
+            {".htm", "text/html; charset=utf-8"},
+            {".js", "text/javascript; charset=utf-8"},
+            {".mjs", "text/javascript; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"},
+            {".svg", "image/svg+xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".webp", "image/webp"},
+            {".ico", "image/x-icon"},
+            {".woff", "font/woff"},
+            {".woff2", "font/woff2"},
+        };
+        const auto found = types.find(extension);
+        return found == types.end() ? std::string() : found->second;
+    }
+
+    static bool is_html(const StaticAsset& asset) { return asset.content_type.rfind("text/html", 0) == 0; }
+
+    static std::string read_file(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open " + path.string());
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    static bool replace_all(std::string& text, const std::string& from, const std::string& to) {
+        bool replaced = false;
+        for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size())) {
+            text.replace(pos, from.size(), to);
+            replaced = true;
+        }
+        return replaced;
+    }
+
+    // FNV-1a: stable across builds and platforms, so content-addressed URLs survive a restart
+    static uint64_t content_hash(std::string_view data) {
+        uint64_t hash = 1469598103934665603ull;
+        for (const unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static void name_by_content(StaticAsset& asset) {
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(content_hash(*asset.bodies[0])));
+        const size_t dot = asset.name.rfind('.');
+        asset.hashed_name = asset.name.substr(0, dot) + "." + hex + asset.name.substr(dot);
+        asset.etag = std::string("\"") + hex + "\"";
+    }
+
+    static void load_precompressed(StaticAsset& asset, const std::filesystem::path& path) {
+        static constexpr std::pair<ContentCoding, const char*> siblings[] = {{ContentCoding::gzip, ".gz"}, {ContentCoding::zstd, ".zst"}};
+        std::error_code ec;
+        const auto modified = std::filesystem::last_write_time(path, ec);
+        if (ec) return;
+        for (const auto& [coding, suffix] : siblings) {
+            std::filesystem::path sibling = path;
+            sibling += suffix;
+            const auto sibling_modified = std::filesystem::last_write_time(sibling, ec);
+            if (ec || sibling_modified < modified) continue;
+            asset.bodies[static_cast<size_t>(coding)] = read_file(sibling);
+        }
+    }
+
+    // Done once per file, so at the codecs' highest levels
+    static void compress_missing(StaticAsset& asset, CompressionOptions options) {
+        options.zlib_level = 9;
+        options.zstd_level = 19;
+        const std::string& body = *asset.bodies[0];
+        if (!compressible_type(asset.content_type) || body.size() < options.min_bytes) return;
+        for (size_t i = 1; i < content_coding_count; ++i) {
+            const ContentCoding coding = static_cast<ContentCoding>(i);
+            if (asset.bodies[i] || !coding_available(coding)) continue;
+            std::string encoded = compress_body(coding, body, options);
+            if (encoded.size() < body.size()) asset.bodies[i] = std::move(encoded);
+        }
+    }
+
+    std::vector<StaticAsset> assets_;
+    std::unordered_map<std::string, Entry> by_name_;
+};
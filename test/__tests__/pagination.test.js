@@ -0,0 +1,69 @@
+import {
+    getPagination,
+    resetPagination,
+    buildPageUrl,
+    recordPage,
+    hasNextPage,
+    previousPage,
+    nextPage,
+    changeItemsPerPage
+} from '../pagination';
+
+const apiBaseUrl = 'http://127.0.0.1:8080/api/books';
+
+describe('keyset pagination', () => {
+    beforeEach(() => {
+        resetPagination(10);
+    });
+
+    it('requests the first page without an after cursor', () => {
+        expect(buildPageUrl(apiBaseUrl, 1)).toBe(`${apiBaseUrl}?limit=10`);
+    });
+
+    it('uses the X-Next-After cursor for the following page', () => {
+        recordPage(1, 'B%20010');
+
+        expect(hasNextPage()).toBe(true);
+        expect(buildPageUrl(apiBaseUrl, 2)).toBe(`${apiBaseUrl}?limit=10&after=B+010`);
+    });
+
+    it('has no next page when the server sends no cursor', () => {
+        recordPage(1, null);
+
+        const loadPage = jest.fn();
+        nextPage(loadPage);
+
+        expect(hasNextPage()).toBe(false);
+        expect(loadPage).not.toHaveBeenCalled();
+    });
+
+    it('moves forward and back through known cursors', () => {
+        const loadPage = jest.fn();
+        recordPage(1, 'B010');
+        nextPage(loadPage);
+        expect(loadPage).toHaveBeenCalledWith(2);
+
+        recordPage(2, 'B020');
+        previousPage(loadPage);
+        expect(loadPage).toHaveBeenLastCalledWith(1);
+        expect(getPagination().pageCursors).toEqual([null, 'B010', 'B020']);
+    });
+
+    it('drops cursors past the reloaded page', () => {
+        recordPage(1, 'B010');
+        recordPage(2, 'B020');
+        recordPage(1, 'B011');
+
+        expect(getPagination().pageCursors).toEqual([null, 'B011']);
+    });
+
+    it('restarts from the first page when the page size changes', () => {
+        const loadPage = jest.fn();
+        recordPage(1, 'B010');
+        changeItemsPerPage(20, loadPage);
+
+        expect(loadPage).toHaveBeenCalledWith(1);
+        expect(getPagination()).toEqual({ currentPage: 1, itemsPerPage: 20, pageCursors: [null] });
+        expect(buildPageUrl(apiBaseUrl, 1)).toBe(`${apiBaseUrl}?limit=20`);
+    });
+});
@@ -1,24 +1,49 @@
-let filteredBooks = [];
+// 按 book_id 的键集分页：pageCursors[i] 是第 i+1 页的 after 游标
 let currentPage = 1;
 let itemsPerPage = 10;
+let pageCursors = [null];
 
-export function previousPage(renderBooks) {
+export function getPagination() {
+    return { currentPage, itemsPerPage, pageCursors: [...pageCursors] };
+}
+
+export function resetPagination(newItemsPerPage = itemsPerPage) {
+    itemsPerPage = newItemsPerPage;
+    currentPage = 1;
+    pageCursors = [null];
+}
+
+export function buildPageUrl(apiBaseUrl, page) {
+    const params = new URLSearchParams({ limit: itemsPerPage });
+    const after = pageCursors[page - 1];
+    if (after) params.append('after', after);
+    return `${apiBaseUrl}?${params.toString()}`;
+}
+
+// 记录后端返回的 X-Next-After，作为下一页的游标
+export function recordPage(page, nextAfter) {
+    currentPage = page;
+    pageCursors.length = page;
+    if (nextAfter) pageCursors.push(decodeURIComponent(nextAfter));
+}
+
+export function hasNextPage() {
+    return pageCursors.length > currentPage;
+}
+
+export function previousPage(loadPage) {
     if (currentPage > 1) {
-        currentPage--;
-        renderBooks();
+        loadPage(currentPage - 1);
     }
 }
 
-export function nextPage(renderBooks, totalItems) {
-    const totalPages = Math.ceil(totalItems / itemsPerPage);
-    if (currentPage < totalPages) {
-        currentPage++;
-        renderBooks();
+export function nextPage(loadPage) {
+    if (hasNextPage()) {
+        loadPage(currentPage + 1);
     }
 }
 
-export function changeItemsPerPage(newItemsPerPage, renderBooks) {
-    itemsPerPage = newItemsPerPage;
-    currentPage = 1;
-    renderBooks();
-}
\ No newline at end of file
+export function changeItemsPerPage(newItemsPerPage, loadPage) {
+    resetPagination(newItemsPerPage);
+    loadPage(1);
+}
@@ -9819,7 +9819,11 @@ namespace crow
                 }
                 if (complete_request_handler_)
                 {
-                    complete_request_handler_();
+                    // Called from a local: for a response ended asynchronously the handler holds
+                    // the only reference to the connection that owns *this, and the connection
+                    // clears the member while writing
+                    auto complete = std::move(complete_request_handler_);
+                    complete();
                     manual_length_header = false;
                     skip_body = false;
                 }
@@ -13225,6 +13229,13 @@ namespace crow
 #include <chrono>
 #include <memory>
 #include <vector>
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
 
 
 namespace crow
@@ -13593,6 +13604,14 @@ namespace crow
         {
             asio::write(adaptor_.socket(), buffers_);
 
+#if defined(__linux__)
+            // Plain TCP on Linux: sendfile() has the kernel copy the file straight to the socket
+            // instead of reading it through a user-space buffer
+            if (res.file_info.statResult == 0 && std::is_same<Adaptor, SocketAdaptor>::value && send_file_zero_copy())
+            {
+                res.file_info.statResult = -1;
+            }
+#endif
             if (res.file_info.statResult == 0)
             {
                 std::ifstream is(res.file_info.path.c_str(), std::ios::in | std::ios::binary);
@@ -13619,6 +13638,53 @@ namespace crow
             parser_.clear();
         }
 
+#if defined(__linux__)
+        /// Sends the static file with sendfile(); false if nothing was sent and the caller should fall back to reading it.
+        /// Like the rest of the write path this runs synchronously on the connection's I/O thread, so a slow client
+        /// holds that thread until the file is sent or it stalls for send_file_stall_ms. A partial send closes the
+        /// connection, since the client has been promised Content-Length bytes.
+        bool send_file_zero_copy()
+        {
+            static constexpr int send_file_stall_ms = 30000;
+            const int fd = ::open(res.file_info.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            auto& socket = adaptor_.raw_socket();
+            off_t offset = 0;
+            const off_t size = res.file_info.statbuf.st_size;
+            while (offset < size)
+            {
+                const ssize_t sent = ::sendfile(socket.native_handle(), fd, &offset, static_cast<size_t>(size - offset));
+                if (sent > 0) continue;
+                if (sent < 0 && errno == EINTR) continue;
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // asio keeps the descriptor non-blocking; wait until the socket can take more, but give up on a
+                    // client that has stopped reading
+                    pollfd pfd{socket.native_handle(), POLLOUT, 0};
+                    int ready;
+                    do
+                    {
+                        ready = ::poll(&pfd, 1, send_file_stall_ms);
+                    } while (ready < 0 && errno == EINTR);
+                    if (ready > 0 && !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) continue;
+                }
+                else if (sent < 0 && offset == 0 && (errno == EINVAL || errno == ENOSYS))
+                {
+                    ::close(fd);
+                    return false;
+                }
+                break;
+            }
+            ::close(fd);
+            if (offset < size)
+            {
+                CROW_LOG_ERROR << this << " sendfile stopped at " << offset << " of " << size << " bytes; closing";
+                close_connection_ = true;
+            }
+            return true;
+        }
+#endif
+
         void do_write_general()
         {
             if (res.body.length() < res_stream_threshold_)
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIBRARY_UTF8_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define LIBRARY_UTF8_NEON 1
+#endif
+
+// Portable UTF-8 <-> UTF-16 transcoding for the ODBC boundary.
+//
+// Both directions append to a caller-owned buffer, so a handler that clears and reuses one
+// string per column allocates only until the buffer has grown to the longest value. Runs of
+// ASCII (most ids, ISBNs and prices-as-text) are converted 8 or 16 code units at a time with
+// SSE2 or NEON; everything else goes through a scalar loop. Unpaired surrogates and malformed
+// UTF-8 become U+FFFD instead of failing the request.
+//
+// The wide side may be char16_t or wchar_t; a 4-byte wchar_t (Linux) is treated as UTF-32.
+
+namespace utf8_detail {
+
+constexpr char32_t replacement = 0xFFFD;
+
+template <class CharT>
+constexpr bool is_utf16 = sizeof(CharT) == 2;
+
+// Writes cp as UTF-8 at p and returns the position after it; cp must be a scalar value
+inline char* encode(char* p, char32_t cp) {
+    if (cp < 0x80) {
+        *p++ = static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        *p++ = static_cast<char>(0xC0 | (cp >> 6));
+        *p++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *p++ = static_cast<char>(0xE0 | (cp >> 12));
+        *p++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *p++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        *p++ = static_cast<char>(0xF0 | (cp >> 18));
+        *p++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *p++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *p++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return p;
+}
+
+// Number of leading UTF-16 units below 0x80 that were copied to dst (a multiple of 8)
+inline size_t ascii_run_from_utf16(char* dst, const char16_t* src, size_t n) {
+    size_t i = 0;
+#if defined(LIBRARY_UTF8_SSE2)
+    const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, high), zero)) != 0xFFFF) break;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(v, v));
+    }
+#elif defined(LIBRARY_UTF8_NEON)
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t*>(src + i));
+        if (vmaxvq_u16(v) >= 0x80) break;
+        vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vmovn_u16(v));
+    }
+#else
+    (void)dst;
+    (void)src;
+    (void)n;
+#endif
+    return i;
+}
+
+// Number of leading ASCII bytes that were widened into dst (a multiple of 16)
+inline size_t ascii_run_from_utf8(char16_t* dst, const char* src, size_t n) {
+    size_t i = 0;
+#if defined(LIBRARY_UTF8_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(v) != 0) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#elif defined(LIBRARY_UTF8_NEON)
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        if (vmaxvq_u8(v) >= 0x80) break;
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + i), vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + i + 8), vmovl_u8(vget_high_u8(v)));
+    }
+#else
+    (void)dst;
+    (void)src;
+    (void)n;
+#endif
+    return i;
+}
+
+// Decodes one code point starting at s[i] and advances i; malformed input yields U+FFFD
+inline char32_t decode(const unsigned char* s, size_t n, size_t& i) {
+    const unsigned char lead = s[i++];
+    if (lead < 0x80) return lead;
+
+    size_t extra;
+    char32_t cp;
+    char32_t min;
+    if ((lead & 0xE0) == 0xC0) {
+        extra = 1, cp = lead & 0x1F, min = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        extra = 2, cp = lead & 0x0F, min = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        extra = 3, cp = lead & 0x07, min = 0x10000;
+    } else {
+        return replacement;
+    }
+    for (size_t k = 0; k < extra; ++k) {
+        if (i >= n || (s[i] & 0xC0) != 0x80) return replacement;
+        cp = (cp << 6) | (s[i++] & 0x3F);
+    }
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return replacement;
+    return cp;
+}
+
+}  // namespace utf8_detail
+
+// Append the UTF-8 form of a UTF-16 (or UTF-32) string to out
+template <class CharT>
+void append_utf8(std::string& out, std::basic_string_view<CharT> in) {
+    using namespace utf8_detail;
+    if (in.empty()) return;
+
+    // Worst case is 3 bytes per UTF-16 unit (a surrogate pair is 4 bytes for 2 units)
+    const size_t start = out.size();
+    out.resize(start + in.size() * (is_utf16<CharT> ? 3 : 4));
+    char* const begin = &out[start];
+    char* p = begin;
+
+    const size_t n = in.size();
+    size_t i = 0;
+    while (i < n) {
+        if constexpr (is_utf16<CharT>) {
+            const size_t run = ascii_run_from_utf16(p, reinterpret_cast<const char16_t*>(in.data() + i), n - i);
+            p += run;
+            i += run;
+            if (i == n) break;
+        }
+
+        char32_t cp = static_cast<char32_t>(in[i++]);
+        if constexpr (is_utf16<CharT>) {
+            if (cp >= 0xD800 && cp <= 0xDBFF && i < n) {
+                const char32_t low = static_cast<char32_t>(in[i]);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+        }
+        if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) cp = replacement;
+        p = encode(p, cp);
+    }
+    out.resize(start + static_cast<size_t>(p - begin));
+}
+
+template <class CharT>
+void append_utf8(std::string& out, const std::basic_string<CharT>& in) {
+    append_utf8(out, std::basic_string_view<CharT>(in));
+}
+
+// Append the UTF-16 (or UTF-32) form of a UTF-8 string to out
+template <class CharT>
+void append_utf16(std::basic_string<CharT>& out, std::string_view in) {
+    using namespace utf8_detail;
+    if (in.empty()) return;
+
+    // Never more code units than input bytes
+    const size_t start = out.size();
+    out.resize(start + in.size());
+    CharT* const begin = &out[start];
+    CharT* p = begin;
+
+    const auto* s = reinterpret_cast<const unsigned char*>(in.data());
+    const size_t n = in.size();
+    size_t i = 0;
+    while (i < n) {
+        if constexpr (is_utf16<CharT>) {
+            const size_t run = ascii_run_from_utf8(reinterpret_cast<char16_t*>(p), in.data() + i, n - i);
+            p += run;
+            i += run;
+            if (i == n) break;
+        }
+
+        const char32_t cp = decode(s, n, i);
+        if (is_utf16<CharT> && cp >= 0x10000) {
+            *p++ = static_cast<CharT>(0xD800 + ((cp - 0x10000) >> 10));
+            *p++ = static_cast<CharT>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        } else {
+            *p++ = static_cast<CharT>(cp);
+        }
+    }
+    out.resize(start + static_cast<size_t>(p - begin));
+}
+
+// Append in to out with every malformed UTF-8 sequence replaced by U+FFFD; returns false if
+// anything was replaced
+inline bool append_valid_utf8(std::string& out, std::string_view in) {
+    using namespace utf8_detail;
+    const auto* s = reinterpret_cast<const unsigned char*>(in.data());
+    const size_t n = in.size();
+    bool valid = true;
+    size_t i = 0;
+    out.reserve(out.size() + n);
+    while (i < n) {
+        size_t run = i;
+        while (run < n && s[run] < 0x80) ++run;
+        out.append(in.data() + i, run - i);
+        i = run;
+        if (i == n) break;
+
+        const size_t lead = i;
+        const char32_t cp = decode(s, n, i);
+        if (cp == replacement && !(i - lead == 3 && s[lead] == 0xEF && s[lead + 1] == 0xBF && s[lead + 2] == 0xBD)) {
+            valid = false;
+            char buffer[4];
+            out.append(buffer, static_cast<size_t>(encode(buffer, replacement) - buffer));
+        } else {
+            out.append(in.data() + lead, i - lead);
+        }
+    }
+    return valid;
+}
+
+// Append the UTF-8 form of ISO-8859-1 (Latin-1) text to out
+inline void append_latin1_as_utf8(std::string& out, std::string_view in) {
+    out.reserve(out.size() + in.size());
+    for (const char c : in) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (byte < 0x80) {
+            out.push_back(c);
+        } else {
+            out.push_back(static_cast<char>(0xC0 | (byte >> 6)));
+            out.push_back(static_cast<char>(0x80 | (byte & 0x3F)));
+        }
+    }
+}